@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <benchmark/benchmark.h>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace bench {
+
+// Log-linear latency histogram: 16 linear sub-buckets per power of two, so
+// any percentile is within ~6% of the true value while recording stays a
+// couple of instructions and the memory use is fixed however long a
+// benchmark runs.
+class LatencyHistogram {
+public:
+  void record(uint64_t ns) {
+    _buckets[bucketOf(ns)]++;
+    _count++;
+  }
+
+  // Lower bound of the bucket holding the `p`th fraction of samples
+  uint64_t percentile(double p) const {
+    if (_count == 0) {
+      return 0;
+    }
+    auto target = static_cast<uint64_t>(p * static_cast<double>(_count - 1));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+      seen += _buckets[i];
+      if (seen > target) {
+        return lowerBound(i);
+      }
+    }
+    return lowerBound(NUM_BUCKETS - 1);
+  }
+
+  // Adds p50/p99/p999 counters, averaged over threads in threaded runs
+  void report(benchmark::State &state) const {
+    auto counter = [](uint64_t ns) {
+      return benchmark::Counter(static_cast<double>(ns),
+                                benchmark::Counter::kAvgThreads);
+    };
+    state.counters["p50_ns"] = counter(percentile(0.50));
+    state.counters["p99_ns"] = counter(percentile(0.99));
+    state.counters["p999_ns"] = counter(percentile(0.999));
+  }
+
+private:
+  static constexpr int SUB_BITS = 4;
+  static constexpr uint64_t SUB_COUNT = uint64_t{1} << SUB_BITS;
+  static constexpr size_t NUM_BUCKETS = 64 << SUB_BITS;
+
+  static size_t bucketOf(uint64_t ns) {
+    if (ns < SUB_COUNT) {
+      return static_cast<size_t>(ns);
+    }
+    int shift = std::bit_width(ns) - 1 - SUB_BITS;
+    return (static_cast<size_t>(shift + 1) << SUB_BITS) +
+           static_cast<size_t>((ns >> shift) & (SUB_COUNT - 1));
+  }
+
+  static uint64_t lowerBound(size_t bucket) {
+    if (bucket < SUB_COUNT) {
+      return bucket;
+    }
+    int shift = static_cast<int>(bucket >> SUB_BITS) - 1;
+    return (SUB_COUNT + (bucket & (SUB_COUNT - 1))) << shift;
+  }
+
+  std::array<uint64_t, NUM_BUCKETS> _buckets{};
+  uint64_t _count{0};
+};
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t elapsedNs(Clock::time_point start, Clock::time_point end) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count());
+}
+
+// Times one operation into `histogram` and returns the seconds it took, for
+// benchmarks that report manual time
+template <typename F>
+double timeOp(LatencyHistogram &histogram, F &&op) {
+  auto start = Clock::now();
+  op();
+  auto end = Clock::now();
+  histogram.record(elapsedNs(start, end));
+  return std::chrono::duration<double>(end - start).count();
+}
+
+} // namespace bench
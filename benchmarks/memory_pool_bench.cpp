@@ -0,0 +1,102 @@
+#include "../include/orderbook/memory_pool.hpp"
+#include "../include/orderbook/order.hpp"
+#include "latency.hpp"
+#include <benchmark/benchmark.h>
+#include <array>
+
+using namespace orderbook;
+
+namespace {
+
+// Shared by every thread of a run, the way OrderAllocator's pool is
+MemoryPool<Order> &sharedPool() {
+  static MemoryPool<Order> pool;
+  return pool;
+}
+
+} // namespace
+
+// Each thread keeps a window of live orders and replaces the oldest one per
+// iteration, so frees and allocations interleave the way a busy book's do.
+// Threads share one pool and contend on it.
+static void BM_PoolChurn(benchmark::State &state) {
+  constexpr size_t WINDOW = 64;
+  auto &pool = sharedPool();
+  std::array<Order *, WINDOW> live;
+  for (size_t i = 0; i < WINDOW; ++i) {
+    live[i] = pool.allocate(i, Side::BUY, Price{1}, 1u);
+  }
+
+  bench::LatencyHistogram latency;
+  size_t next = 0;
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      pool.deallocate(live[next]);
+      live[next] = pool.allocate(next, Side::BUY, Price{1}, 1u);
+    }));
+    benchmark::DoNotOptimize(live[next]);
+    next = (next + 1) % WINDOW;
+  }
+
+  for (auto *order : live) {
+    pool.deallocate(order);
+  }
+  latency.report(state);
+}
+BENCHMARK(BM_PoolChurn)->ThreadRange(1, 8)->UseManualTime();
+
+// Allocate and immediately free one order, the pool's best case
+static void BM_PoolAllocateFree(benchmark::State &state) {
+  auto &pool = sharedPool();
+  bench::LatencyHistogram latency;
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      Order *order = pool.allocate(uint64_t{1}, Side::SELL, Price{1}, 1u);
+      benchmark::DoNotOptimize(order);
+      pool.deallocate(order);
+    }));
+  }
+  latency.report(state);
+}
+BENCHMARK(BM_PoolAllocateFree)->ThreadRange(1, 8)->UseManualTime();
+
+namespace {
+
+MemoryPool<Order> &burstPool(FreeListMode mode) {
+  static MemoryPool<Order> mutex_pool(
+      PoolOptions{PoolGrowth::GEOMETRIC, FreeListMode::MUTEX});
+  static MemoryPool<Order> lock_free_pool(
+      PoolOptions{PoolGrowth::GEOMETRIC, FreeListMode::LOCK_FREE});
+  return mode == FreeListMode::MUTEX ? mutex_pool : lock_free_pool;
+}
+
+} // namespace
+
+// Allocate a burst larger than a magazine and free it again, so every burst
+// goes through the central free list. Compares the mutex and lock-free
+// central lists under contention.
+static void BM_PoolBurst(benchmark::State &state, FreeListMode mode) {
+  constexpr size_t BURST = 256;
+  auto &pool = burstPool(mode);
+  std::array<Order *, BURST> orders;
+  bench::LatencyHistogram latency;
+
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      for (size_t i = 0; i < BURST; ++i) {
+        orders[i] = pool.allocate(uint64_t{i}, Side::BUY, Price{1}, 1u);
+      }
+      for (auto *order : orders) {
+        pool.deallocate(order);
+      }
+    }));
+  }
+  state.SetItemsProcessed(state.iterations() * BURST);
+  latency.report(state);
+}
+BENCHMARK_CAPTURE(BM_PoolBurst, mutex, FreeListMode::MUTEX)
+    ->ThreadRange(1, 8)
+    ->UseManualTime();
+BENCHMARK_CAPTURE(BM_PoolBurst, lock_free, FreeListMode::LOCK_FREE)
+    ->ThreadRange(1, 8)
+    ->UseManualTime();
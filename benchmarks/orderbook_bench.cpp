@@ -0,0 +1,173 @@
+#include "../include/orderbook/order_allocator.hpp"
+#include "../include/orderbook/orderbook.hpp"
+#include "latency.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+using namespace orderbook;
+
+namespace {
+
+Price ticks(double price) { return PriceScale{}.toTicks(price); }
+
+// Rests `depth` sell orders over 100 price levels, ids 1..depth
+void fillBook(OrderBook &book, int64_t depth) {
+  for (int64_t i = 1; i <= depth; ++i) {
+    Order *order =
+        OrderAllocator::create(i, Side::SELL, ticks(100.0 + i % 100), 1);
+    book.addOrder(*order);
+    OrderAllocator::destroy(order);
+  }
+}
+
+} // namespace
+
+// Add a non-crossing order to a book holding `depth` resting orders. The
+// order is cancelled again outside the timed region.
+static void BM_AddOrder(benchmark::State &state) {
+  const int64_t depth = state.range(0);
+  OrderBook book;
+  fillBook(book, depth);
+  bench::LatencyHistogram latency;
+
+  std::mt19937_64 gen(42);
+  std::uniform_int_distribution<int> level_dist(0, 99);
+  uint64_t id = depth;
+
+  for (auto _ : state) {
+    Order *order = OrderAllocator::create(++id, Side::BUY,
+                                          ticks(99.0 - level_dist(gen)), 1);
+    state.SetIterationTime(
+        bench::timeOp(latency, [&]() { book.addOrder(*order); }));
+    book.cancelOrder(id);
+    OrderAllocator::destroy(order);
+  }
+  latency.report(state);
+}
+BENCHMARK(BM_AddOrder)
+    ->RangeMultiplier(4)
+    ->Range(1 << 10, 1 << 16)
+    ->UseManualTime();
+
+// Cancel latency against a book holding `depth` resting orders. Each cancelled
+// order is re-added outside the timed region so the depth stays constant.
+static void BM_CancelOrder(benchmark::State &state) {
+  const int64_t depth = state.range(0);
+  OrderBook book;
+  fillBook(book, depth);
+
+  bench::LatencyHistogram latency;
+
+  std::mt19937_64 gen(42);
+  std::uniform_int_distribution<uint64_t> id_dist(1, depth);
+
+  for (auto _ : state) {
+    uint64_t id = id_dist(gen);
+
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      benchmark::DoNotOptimize(book.cancelOrder(id));
+    }));
+
+    Order *order =
+        OrderAllocator::create(id, Side::SELL, ticks(100.0 + id % 100), 1);
+    book.addOrder(*order);
+    OrderAllocator::destroy(order);
+  }
+  latency.report(state);
+}
+BENCHMARK(BM_CancelOrder)
+    ->RangeMultiplier(4)
+    ->Range(1 << 10, 1 << 20)
+    ->UseManualTime();
+
+// Fill the front of a single hot level holding `depth` orders, then requeue
+// the filled order at the back so the level stays the same size
+static void BM_FillHotLevel(benchmark::State &state) {
+  const int64_t depth = state.range(0);
+  OrderBook book;
+  for (int64_t i = 1; i <= depth; ++i) {
+    Order *order = OrderAllocator::create(i, Side::SELL, ticks(100.0), 1);
+    book.addOrder(*order);
+    OrderAllocator::destroy(order);
+  }
+
+  bench::LatencyHistogram latency;
+  Order *buy = OrderAllocator::create(0, Side::BUY, ticks(100.0), 1);
+  for (auto _ : state) {
+    std::optional<Order> filled;
+    state.SetIterationTime(
+        bench::timeOp(latency, [&]() { filled = book.matchOrder(*buy); }));
+    Order *order =
+        OrderAllocator::create(filled->getId(), Side::SELL, ticks(100.0), 1);
+    book.addOrder(*order);
+    OrderAllocator::destroy(order);
+  }
+  OrderAllocator::destroy(buy);
+  latency.report(state);
+}
+BENCHMARK(BM_FillHotLevel)
+    ->RangeMultiplier(8)
+    ->Range(8, 1 << 15)
+    ->UseManualTime();
+
+// Churn the top of the book: open a new best level and cancel it again, on
+// top of 100 resting levels per side
+static void BM_LevelChurn(benchmark::State &state, bool use_ladder) {
+  auto book = use_ladder ? std::make_unique<OrderBook>(
+                               LadderConfig{ticks(0.01), ticks(50.0),
+                                            ticks(150.0)})
+                         : std::make_unique<OrderBook>();
+  for (int i = 0; i < 100; ++i) {
+    Order *bid =
+        OrderAllocator::create(i + 1, Side::BUY, ticks(99.0 - i * 0.01), 1);
+    Order *ask =
+        OrderAllocator::create(i + 101, Side::SELL, ticks(101.0 + i * 0.01), 1);
+    book->addOrder(*bid);
+    book->addOrder(*ask);
+    OrderAllocator::destroy(bid);
+    OrderAllocator::destroy(ask);
+  }
+
+  bench::LatencyHistogram latency;
+  Order *order = OrderAllocator::create(0, Side::BUY, ticks(100.0), 1);
+  for (auto _ : state) {
+    auto start = bench::Clock::now();
+    book->addOrder(*order);
+    benchmark::DoNotOptimize(book->getBestBid());
+    book->cancelOrder(order->getId());
+    latency.record(bench::elapsedNs(start, bench::Clock::now()));
+  }
+  OrderAllocator::destroy(order);
+  latency.report(state);
+}
+BENCHMARK_CAPTURE(BM_LevelChurn, map, false);
+BENCHMARK_CAPTURE(BM_LevelChurn, ladder, true);
+
+// Sweep an aggressive order through `levels` levels of one order each, with
+// fills written to a stack buffer. Only the sweep itself is timed.
+static void BM_SweepLevels(benchmark::State &state) {
+  const int64_t levels = state.range(0);
+  OrderBook book;
+  std::vector<Fill> fills(levels);
+  bench::LatencyHistogram latency;
+  Order *buy = OrderAllocator::create(0, Side::BUY, ticks(200.0), levels);
+
+  for (auto _ : state) {
+    for (int64_t i = 1; i <= levels; ++i) {
+      Order *order =
+          OrderAllocator::create(i, Side::SELL, ticks(100.0 + i * 0.01), 1);
+      book.addOrder(*order);
+      OrderAllocator::destroy(order);
+    }
+
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      benchmark::DoNotOptimize(book.matchOrder(*buy, fills));
+    }));
+  }
+  OrderAllocator::destroy(buy);
+  latency.report(state);
+}
+BENCHMARK(BM_SweepLevels)->RangeMultiplier(8)->Range(1, 512)->UseManualTime();
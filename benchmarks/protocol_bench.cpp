@@ -0,0 +1,147 @@
+#include "../include/network/frame_decoder.hpp"
+#include "../include/network/protocol.hpp"
+#include "../include/network/zero_copy.hpp"
+#include "latency.hpp"
+#include <benchmark/benchmark.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace network;
+
+static void BM_SerializeNewOrder(benchmark::State &state) {
+  bench::LatencyHistogram latency;
+  uint64_t order_id = 0;
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      benchmark::DoNotOptimize(BinaryProtocol::serializeNewOrder(
+          ++order_id, true, 1502500, 100, "AAPL", "default"));
+    }));
+  }
+  latency.report(state);
+}
+BENCHMARK(BM_SerializeNewOrder)->UseManualTime();
+
+static void BM_SerializeMarketData(benchmark::State &state) {
+  bench::LatencyHistogram latency;
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      benchmark::DoNotOptimize(BinaryProtocol::serializeMarketData(
+          "AAPL", 1502500, 1503000, 100, 200));
+    }));
+  }
+  latency.report(state);
+}
+BENCHMARK(BM_SerializeMarketData)->UseManualTime();
+
+// Byte-swap a whole order's worth of fields there and back, too short to
+// time one at a time so only ns/op is reported
+static void BM_ByteSwapOrderFields(benchmark::State &state) {
+  uint64_t value = 0x0123456789abcdefULL;
+  for (auto _ : state) {
+    uint64_t id = BinaryProtocol::hton64(value);
+    uint64_t price = BinaryProtocol::hton64(value + 1);
+    uint32_t quantity = BinaryProtocol::hton32(static_cast<uint32_t>(value));
+    benchmark::DoNotOptimize(BinaryProtocol::ntoh64(id));
+    benchmark::DoNotOptimize(BinaryProtocol::ntoh64(price));
+    benchmark::DoNotOptimize(BinaryProtocol::ntoh32(quantity));
+    value++;
+  }
+}
+BENCHMARK(BM_ByteSwapOrderFields);
+
+// Gather `size` bytes into the handler's buffers, writev them through a unix
+// socket pair and readv them back on the far side
+static void BM_ZeroCopyRoundTrip(benchmark::State &state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    state.SkipWithError("socketpair failed");
+    return;
+  }
+
+  ZeroCopyHandler writer;
+  ZeroCopyHandler reader;
+  writer.initBuffers(4096);
+  reader.initBuffers(4096);
+  std::vector<uint8_t> payload(size, 0xab);
+  bench::LatencyHistogram latency;
+
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      writer.addToBuffer(payload.data(), payload.size());
+      writer.writeBuffers(fds[0]);
+      writer.clear();
+      size_t received = 0;
+      while (received < size) {
+        ssize_t n = reader.readToBuffers(fds[1]);
+        if (n <= 0) {
+          throw std::runtime_error("readv failed");
+        }
+        received += static_cast<size_t>(n);
+      }
+    }));
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+
+  close(fds[0]);
+  close(fds[1]);
+  latency.report(state);
+}
+BENCHMARK(BM_ZeroCopyRoundTrip)
+    ->RangeMultiplier(4)
+    ->Range(64, 16 << 10)
+    ->UseManualTime();
+
+// `batch` pipelined orders written in one go, then read back with a single
+// recv into a connection's stream buffer and decoded in place
+static void BM_DecodePipelinedFrames(benchmark::State &state) {
+  const size_t batch = static_cast<size_t>(state.range(0));
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    state.SkipWithError("socketpair failed");
+    return;
+  }
+
+  std::vector<uint8_t> stream;
+  for (size_t i = 0; i < batch; ++i) {
+    auto order = BinaryProtocol::serializeNewOrder(i, true, 1502500, 100,
+                                                   "AAPL", "default");
+    stream.insert(stream.end(), order.begin(), order.end());
+  }
+  StreamBuffer input;
+  FrameDecoder frames(input);
+  bench::LatencyHistogram latency;
+
+  for (auto _ : state) {
+    if (write(fds[0], stream.data(), stream.size()) !=
+        static_cast<ssize_t>(stream.size())) {
+      throw std::runtime_error("write failed");
+    }
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      size_t decoded = 0;
+      while (decoded < batch) {
+        auto space = input.prepare(4096);
+        ssize_t n = recv(fds[1], space.data(), space.size(), 0);
+        if (n <= 0) {
+          throw std::runtime_error("recv failed");
+        }
+        input.commit(static_cast<size_t>(n));
+        while (auto frame = frames.next()) {
+          benchmark::DoNotOptimize(frame->bytes.data());
+          ++decoded;
+        }
+      }
+    }));
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+
+  close(fds[0]);
+  close(fds[1]);
+  latency.report(state);
+}
+BENCHMARK(BM_DecodePipelinedFrames)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->UseManualTime();
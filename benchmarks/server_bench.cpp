@@ -0,0 +1,130 @@
+#include "../include/network/protocol.hpp"
+#include "../include/network/server.hpp"
+#include "../include/session/session.hpp"
+#include "../tests/support/allocation_counter.hpp"
+#include "latency.hpp"
+#include <arpa/inet.h>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace network;
+
+namespace {
+
+constexpr uint16_t BENCH_PORT = 8095;
+
+// Layout of the server's binary order ack
+struct OrderAck {
+  MessageHeader header;
+  uint64_t order_id;
+  uint8_t success;
+  char message[256];
+};
+
+int connectClient() {
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(BENCH_PORT);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (sock < 0 || connect(sock, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    throw std::runtime_error("Failed to connect to the bench server");
+  }
+  return sock;
+}
+
+void sendAll(int sock, const std::vector<uint8_t> &bytes) {
+  if (send(sock, bytes.data(), bytes.size(), 0) !=
+      static_cast<ssize_t>(bytes.size())) {
+    throw std::runtime_error("Failed to send");
+  }
+}
+
+template <typename T> void recvAll(int sock, T &out) {
+  if (recv(sock, &out, sizeof(out), MSG_WAITALL) != sizeof(out)) {
+    throw std::runtime_error("Failed to receive");
+  }
+}
+
+} // namespace
+
+// One client round-tripping binary orders through the server: a buy that
+// rests, then a sell that fills it, so the book stays empty. Arg 0 names the
+// session and symbol in every order, arg 1 uses the refs from JOIN_ACK and
+// arg 2 sends both as one NEW_ORDER_BATCH. Reports global allocations per
+// order, server and client threads alike.
+static void BM_ServerOrderRoundTrip(benchmark::State &state) {
+  const int64_t mode = state.range(0);
+  NetworkServer server(BENCH_PORT, true);
+  server.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  int sock = connectClient();
+  sendAll(sock, BinaryProtocol::serializeJoin("bench", "default"));
+  JoinAckMessage join_ack;
+  recvAll(sock, join_ack);
+  SymbolRef symbol_ref;
+  recvAll(sock, symbol_ref);
+  uint32_t session_ref = BinaryProtocol::ntoh32(join_ack.session_ref);
+  uint32_t stock_ref = BinaryProtocol::ntoh32(symbol_ref.symbol_ref);
+
+  // Enough to sell into every buy the benchmark can make
+  server.getSession("default")->getUser("bench")->addPosition("STOCK",
+                                                              1u << 30);
+
+  std::vector<uint8_t> orders[2];
+  for (int i = 0; i < 2; ++i) {
+    bool is_buy = i == 0;
+    orders[i] = mode == 0 ? BinaryProtocol::serializeNewOrder(
+                                i + 1, is_buy, 100, 1, "STOCK", "default")
+                          : BinaryProtocol::serializeNewOrderRef(
+                                i + 1, is_buy, 100, 1, session_ref, stock_ref);
+  }
+  const BatchOrder entries[] = {{1, 0, 100, 1, stock_ref},
+                                {2, 1, 100, 1, stock_ref}};
+  auto batch = BinaryProtocol::serializeNewOrderBatch(session_ref, entries);
+
+  OrderAck ack;
+  struct {
+    OrderAckBatchMessage header;
+    BatchAck acks[2];
+  } batch_ack;
+  auto roundTrip = [&]() {
+    if (mode == 2) {
+      sendAll(sock, batch);
+      recvAll(sock, batch_ack);
+      return;
+    }
+    for (const auto &order : orders) {
+      sendAll(sock, order);
+      recvAll(sock, ack);
+    }
+  };
+  for (int i = 0; i < 100; ++i) {
+    roundTrip(); // buffers and pools settle into their steady state
+  }
+
+  bench::LatencyHistogram latency;
+  allocations::global_count.store(0);
+  allocations::counting_global.store(true);
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, roundTrip));
+  }
+  allocations::counting_global.store(false);
+
+  close(sock);
+  server.stop();
+
+  state.SetItemsProcessed(state.iterations() * 2);
+  state.counters["allocs_per_order"] =
+      static_cast<double>(allocations::global_count.load()) /
+      static_cast<double>(state.iterations() * 2);
+  latency.report(state);
+}
+BENCHMARK(BM_ServerOrderRoundTrip)->Arg(0)->Arg(1)->Arg(2)->UseManualTime();
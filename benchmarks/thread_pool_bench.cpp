@@ -0,0 +1,167 @@
+#include "../include/network/ring_queue.hpp"
+#include "../include/network/task_queue.hpp"
+#include "../include/network/thread_pool.hpp"
+#include "../include/network/work_stealing_pool.hpp"
+#include "../tests/support/allocation_counter.hpp"
+#include "latency.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+using network::ThreadPool;
+using network::WorkStealingPool;
+
+namespace {
+
+constexpr int NUM_WORKERS = 4;
+
+} // namespace
+
+// Submit a batch of tiny tasks from outside the pool and wait on every
+// future. Nearly all the time goes to submit and dispatch.
+template <typename Pool> static void BM_SmallTasks(benchmark::State &state) {
+  const int64_t tasks = state.range(0);
+  Pool pool;
+  pool.init(NUM_WORKERS);
+  std::vector<std::future<int64_t>> futures;
+  futures.reserve(tasks);
+  bench::LatencyHistogram latency;
+
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      for (int64_t i = 0; i < tasks; ++i) {
+        futures.push_back(pool.async([i]() { return i; }));
+      }
+      for (auto &future : futures) {
+        benchmark::DoNotOptimize(future.get());
+      }
+    }));
+    futures.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * tasks);
+  latency.report(state);
+}
+BENCHMARK_TEMPLATE(BM_SmallTasks, ThreadPool)->Arg(1000)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_SmallTasks, WorkStealingPool)
+    ->Arg(1000)
+    ->UseManualTime();
+
+// Each worker gets one root task that submits its share of children from
+// inside the pool, the case local push and stealing are meant for
+template <typename Pool> static void BM_FanOut(benchmark::State &state) {
+  const int64_t tasks = state.range(0);
+  Pool pool;
+  pool.init(NUM_WORKERS);
+  std::atomic<int64_t> done{0};
+  bench::LatencyHistogram latency;
+
+  for (auto _ : state) {
+    done.store(0);
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      for (int root = 0; root < NUM_WORKERS; ++root) {
+        pool.async([&]() {
+          for (int64_t i = 0; i < tasks / NUM_WORKERS; ++i) {
+            pool.async([&]() { done.fetch_add(1); });
+          }
+        });
+      }
+      while (done.load() < tasks / NUM_WORKERS * NUM_WORKERS) {
+        std::this_thread::yield();
+      }
+    }));
+  }
+  state.SetItemsProcessed(state.iterations() * tasks);
+  latency.report(state);
+}
+BENCHMARK_TEMPLATE(BM_FanOut, ThreadPool)->Arg(1000)->UseManualTime();
+BENCHMARK_TEMPLATE(BM_FanOut, WorkStealingPool)->Arg(1000)->UseManualTime();
+
+namespace {
+
+struct BoundedQueue : network::RingQueue<int> {
+  BoundedQueue() : network::RingQueue<int>(1024) {}
+};
+
+} // namespace
+
+// Each thread pushes one item and pops one, so every queue operation races
+// the other threads on the same queue
+template <typename Queue> static void BM_QueueHandoff(benchmark::State &state) {
+  static Queue queue;
+  bench::LatencyHistogram latency;
+  int item = 0;
+
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, [&]() {
+      queue.push(item);
+      while (!queue.tryPop(item)) {
+      }
+    }));
+  }
+  latency.report(state);
+}
+BENCHMARK_TEMPLATE(BM_QueueHandoff, network::TaskQueue<int>)
+    ->ThreadRange(1, 8)
+    ->UseManualTime();
+BENCHMARK_TEMPLATE(BM_QueueHandoff, BoundedQueue)
+    ->ThreadRange(1, 8)
+    ->UseManualTime();
+
+enum class SubmitMode { SUBMIT, ASYNC };
+
+// Fire-and-forget submits against future-returning ones. Reports the global
+// allocations made per task, counted on every thread, submitter and workers.
+template <typename Pool>
+static void runSubmit(benchmark::State &state, SubmitMode mode) {
+  constexpr int64_t TASKS = 1000;
+  Pool pool;
+  pool.init(NUM_WORKERS);
+  std::atomic<int64_t> done{0};
+  bench::LatencyHistogram latency;
+
+  auto runBatch = [&]() {
+    done.store(0);
+    for (int64_t i = 0; i < TASKS; ++i) {
+      if (mode == SubmitMode::SUBMIT) {
+        pool.submit([&done]() { done.fetch_add(1); });
+      } else {
+        pool.async([&done]() { done.fetch_add(1); });
+      }
+    }
+    while (done.load() < TASKS) {
+      std::this_thread::yield();
+    }
+  };
+  runBatch(); // queues settle into their steady state
+
+  allocations::global_count.store(0);
+  allocations::counting_global.store(true);
+  for (auto _ : state) {
+    state.SetIterationTime(bench::timeOp(latency, runBatch));
+  }
+  allocations::counting_global.store(false);
+
+  state.SetItemsProcessed(state.iterations() * TASKS);
+  state.counters["allocs_per_task"] =
+      static_cast<double>(allocations::global_count.load()) /
+      static_cast<double>(state.iterations() * TASKS);
+  latency.report(state);
+}
+
+static void BM_SubmitThreadPool(benchmark::State &state, SubmitMode mode) {
+  runSubmit<ThreadPool>(state, mode);
+}
+BENCHMARK_CAPTURE(BM_SubmitThreadPool, submit, SubmitMode::SUBMIT)
+    ->UseManualTime();
+BENCHMARK_CAPTURE(BM_SubmitThreadPool, async, SubmitMode::ASYNC)
+    ->UseManualTime();
+
+static void BM_SubmitWorkStealing(benchmark::State &state, SubmitMode mode) {
+  runSubmit<WorkStealingPool>(state, mode);
+}
+BENCHMARK_CAPTURE(BM_SubmitWorkStealing, submit, SubmitMode::SUBMIT)
+    ->UseManualTime();
+BENCHMARK_CAPTURE(BM_SubmitWorkStealing, async, SubmitMode::ASYNC)
+    ->UseManualTime();
@@ -0,0 +1,63 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include "io_backend.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace network {
+
+// A few event loop threads serving every connection. Sockets are
+// non-blocking and registered edge-triggered, so a loop drains each ready
+// socket into its connection's input buffer, hands complete messages to the
+// handler and writes replies until the socket pushes back, then moves on.
+// Every loop watches the listening socket with EPOLLEXCLUSIVE, and a client
+// stays on the loop that accepted it. A suspended connection reads no more
+// until another thread resumes it through its loop's wake fd.
+class EpollBackend : public IoBackend {
+public:
+  EpollBackend(ConnectionHandler &handler, size_t num_loops);
+  ~EpollBackend() override;
+
+  EpollBackend(const EpollBackend &) = delete;
+  EpollBackend &operator=(const EpollBackend &) = delete;
+
+  void start(int listen_fd) override;
+  void stop() override;
+  size_t getThreadCount() const override;
+
+private:
+  struct Loop : ConnectionLoop {
+    void resume(Connection &connection) override;
+
+    int epoll_fd{-1};
+    int wake_fd{-1}; // eventfd, written to stop the loop or resume clients
+    std::thread thread;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    ResumeQueue resumed;
+    // Closed while suspended, freed once resumed
+    std::unordered_map<Connection *, std::unique_ptr<Connection>> orphans;
+  };
+
+  void run(Loop &loop);
+  void acceptClients(Loop &loop);
+  // Returns false once the connection should be closed
+  bool readInput(Connection &connection);
+  bool dispatch(Connection &connection);
+  bool flushOutput(Connection &connection);
+  void resumeConnections(Loop &loop);
+  void closeConnection(Loop &loop, Connection &connection);
+
+  ConnectionHandler &_handler;
+  int _listen_fd{-1};
+  std::atomic<bool> _running{false};
+  std::vector<std::unique_ptr<Loop>> _loops;
+};
+
+} // namespace network
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "protocol.hpp"
+#include "stream_buffer.hpp"
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace network {
+
+struct Frame {
+  MessageHeader header;           // length and seq_num in host order
+  std::span<const uint8_t> bytes; // the whole frame, header included
+};
+
+// Splits the binary protocol's MessageHeader-framed byte stream. Each call
+// to next() consumes one complete frame from the buffer and returns a view
+// of it in place, valid until the buffer is next read into. A partial frame
+// is left in the buffer for the next read to complete.
+class FrameDecoder {
+public:
+  explicit FrameDecoder(StreamBuffer &input) : _input(input) {}
+
+  std::optional<Frame> next() {
+    if (_input.size() < sizeof(MessageHeader)) {
+      return std::nullopt;
+    }
+    Frame frame;
+    std::memcpy(&frame.header, _input.data(), sizeof(MessageHeader));
+    frame.header.length = BinaryProtocol::ntoh16(frame.header.length);
+    frame.header.seq_num = BinaryProtocol::ntoh32(frame.header.seq_num);
+
+    size_t frame_size = sizeof(MessageHeader) + frame.header.length;
+    if (_input.size() < frame_size) {
+      return std::nullopt;
+    }
+    frame.bytes = {_input.data(), frame_size};
+    _input.consume(frame_size);
+    return frame;
+  }
+
+private:
+  StreamBuffer &_input;
+};
+
+// Splits a newline-delimited text stream the same way. Lines come back
+// without their "\n" or "\r\n", and a line with no newline yet is left in
+// the buffer.
+class LineDecoder {
+public:
+  explicit LineDecoder(StreamBuffer &input) : _input(input) {}
+
+  std::optional<std::string_view> next() {
+    if (_input.empty()) {
+      return std::nullopt;
+    }
+    const auto *begin = reinterpret_cast<const char *>(_input.data());
+    const void *newline = std::memchr(begin, '\n', _input.size());
+    if (!newline) {
+      return std::nullopt;
+    }
+    size_t length = static_cast<const char *>(newline) - begin;
+    _input.consume(length + 1);
+    if (length > 0 && begin[length - 1] == '\r') {
+      --length;
+    }
+    return std::string_view(begin, length);
+  }
+
+  // Bytes waiting for a newline
+  size_t getPending() const { return _input.size(); }
+
+private:
+  StreamBuffer &_input;
+};
+
+} // namespace network
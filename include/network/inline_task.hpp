@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace network {
+
+// Move-only void() callable that stores small callables in place. Anything
+// that fits INLINE_SIZE, the usual lambda capturing a few pointers or a
+// shared_ptr, needs no allocation. Larger ones fall back to the heap. Fills
+// one cache line.
+class InlineTask {
+public:
+  static constexpr size_t INLINE_SIZE = 48;
+
+  InlineTask() = default;
+
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_same_v<std::decay_t<F>, InlineTask>>>
+  InlineTask(F &&f) {
+    using Fn = std::decay_t<F>;
+    if constexpr (fitsInline<Fn>()) {
+      new (_storage) Fn(std::forward<F>(f));
+      _ops = &INLINE_OPS<Fn>;
+    } else {
+      *reinterpret_cast<Fn **>(_storage) = new Fn(std::forward<F>(f));
+      _ops = &HEAP_OPS<Fn>;
+    }
+  }
+
+  InlineTask(InlineTask &&other) noexcept { moveFrom(other); }
+
+  InlineTask &operator=(InlineTask &&other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  InlineTask(const InlineTask &) = delete;
+  InlineTask &operator=(const InlineTask &) = delete;
+
+  ~InlineTask() { reset(); }
+
+  explicit operator bool() const { return _ops != nullptr; }
+
+  void operator()() { _ops->invoke(_storage); }
+
+private:
+  struct Ops {
+    void (*invoke)(void *storage);
+    void (*move)(void *from, void *to) noexcept;
+    void (*destroy)(void *storage) noexcept;
+  };
+
+  template <typename Fn> static constexpr bool fitsInline() {
+    return sizeof(Fn) <= INLINE_SIZE &&
+           alignof(Fn) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible_v<Fn>;
+  }
+
+  template <typename Fn>
+  static constexpr Ops INLINE_OPS{
+      [](void *storage) { (*static_cast<Fn *>(storage))(); },
+      [](void *from, void *to) noexcept {
+        new (to) Fn(std::move(*static_cast<Fn *>(from)));
+        static_cast<Fn *>(from)->~Fn();
+      },
+      [](void *storage) noexcept { static_cast<Fn *>(storage)->~Fn(); }};
+
+  template <typename Fn>
+  static constexpr Ops HEAP_OPS{
+      [](void *storage) { (**static_cast<Fn **>(storage))(); },
+      [](void *from, void *to) noexcept {
+        *static_cast<Fn **>(to) = *static_cast<Fn **>(from);
+      },
+      [](void *storage) noexcept { delete *static_cast<Fn **>(storage); }};
+
+  void moveFrom(InlineTask &other) noexcept {
+    if (other._ops) {
+      other._ops->move(other._storage, _storage);
+      _ops = other._ops;
+      other._ops = nullptr;
+    }
+  }
+
+  void reset() noexcept {
+    if (_ops) {
+      _ops->destroy(_storage);
+      _ops = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) std::byte _storage[INLINE_SIZE];
+  const Ops *_ops{nullptr};
+};
+
+} // namespace network
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "stream_buffer.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace network {
+
+struct Connection;
+
+// The thread a backend serves a connection on. A handler that hands a
+// connection's work to another thread sets Connection::suspended first, and
+// that thread calls resume() once the work is done. The backend then clears
+// the flag and runs ConnectionHandler::onResumed back on the connection's
+// own thread. Until then it holds off onReadable, and it never frees a
+// connection that is still suspended.
+class ConnectionLoop {
+public:
+  virtual ~ConnectionLoop() = default;
+
+  // Safe from any thread, once per suspension
+  virtual void resume(Connection &connection) = 0;
+};
+
+// State for one client socket, owned by the backend serving it. Only the
+// thread the backend runs the connection on ever touches it.
+struct Connection {
+  explicit Connection(int fd, ConnectionLoop *loop = nullptr)
+      : fd(fd), loop(loop) {}
+
+  int fd;                      // -1 once the backend has closed it
+  StreamBuffer input;          // read but not yet consumed by the handler
+  std::vector<uint8_t> output; // replies not yet written
+  size_t output_sent{0};       // prefix of output already on the wire
+  std::shared_ptr<void> state; // whatever the handler keeps per client
+  ConnectionLoop *loop;        // the backend thread serving it
+  bool suspended{false};       // owed a resume, see ConnectionLoop
+  Connection *next_resumed{nullptr}; // link in a ResumeQueue
+
+  void queue(const void *data, size_t length) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    output.insert(output.end(), bytes, bytes + length);
+  }
+};
+
+// Connections resumed from other threads, waiting for their loop. Each one
+// links itself in, so the queue never fills or allocates, and any thread
+// may push while the loop takes everything at once.
+class ResumeQueue {
+public:
+  // Returns true if the queue was empty, in which case the loop needs waking
+  bool push(Connection &connection) {
+    Connection *head = _head.load(std::memory_order_relaxed);
+    do {
+      connection.next_resumed = head;
+    } while (!_head.compare_exchange_weak(head, &connection,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+    return head == nullptr;
+  }
+
+  // Everything pushed so far, oldest first, linked through next_resumed
+  Connection *takeAll() {
+    Connection *newest = _head.exchange(nullptr, std::memory_order_acquire);
+    Connection *oldest = nullptr;
+    while (newest) {
+      Connection *next = newest->next_resumed;
+      newest->next_resumed = oldest;
+      oldest = newest;
+      newest = next;
+    }
+    return oldest;
+  }
+
+private:
+  std::atomic<Connection *> _head{nullptr};
+};
+
+// Protocol logic the backends drive. Called on the connection's thread.
+class ConnectionHandler {
+public:
+  virtual ~ConnectionHandler() = default;
+
+  // New bytes were appended to `connection.input`. Consumes whatever
+  // complete messages it holds and queues replies on the connection. A
+  // partial message is left in the buffer. Not called while the connection
+  // is suspended.
+  virtual void onReadable(Connection &connection) = 0;
+  // The work the connection was suspended on is done. Queues its replies,
+  // then carries on with any input that arrived meanwhile.
+  virtual void onResumed(Connection &connection) = 0;
+  // The peer went away, runs once just before the socket is closed. A
+  // suspended connection is no longer resumed after this.
+  virtual void onClosed(Connection &connection) = 0;
+};
+
+enum class IoBackendType {
+  THREADS, // blocking sockets, one pooled thread per connection
+  EPOLL,   // edge-triggered epoll event loops, Linux only
+  IO_URING // io_uring completion loops, Linux 6.0 or newer
+};
+
+// Accepts clients from a listening socket and moves bytes between their
+// sockets and Connection buffers
+class IoBackend {
+public:
+  virtual ~IoBackend() = default;
+
+  // The backend owns neither the handler nor the listening socket
+  virtual void start(int listen_fd) = 0;
+  // Returns once no thread is inside the handler any more
+  virtual void stop() = 0;
+  virtual size_t getThreadCount() const = 0;
+
+  // EPOLL where the platform has it, THREADS elsewhere
+  static IoBackendType defaultType();
+  // Throws std::invalid_argument for a type this platform lacks, and
+  // std::runtime_error if the running kernel cannot support it
+  static std::unique_ptr<IoBackend>
+  create(IoBackendType type, ConnectionHandler &handler, size_t threads);
+};
+
+} // namespace network
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace network {
+
+// The fields of one JSON request. Unknown keys are ignored, absent fields
+// are left empty for the handler to reject.
+struct JsonRequest {
+  std::string type;
+  std::string username;
+  std::string session_id{"default"};
+  std::string symbol{"STOCK"};
+  std::string side;
+  std::optional<uint64_t> order_id;
+  std::optional<double> price;
+  std::optional<uint32_t> quantity;
+
+  // Back to defaults, keeping the strings' storage for the next message
+  void reset();
+};
+
+// Newline-delimited JSON: each request is one object on its own line, and
+// each reply ends with a newline
+class JsonProtocol {
+public:
+  // Requests longer than this are a protocol error
+  static constexpr size_t MAX_LINE = 64 * 1024;
+
+  // SAX-parses `line` straight into `request`, without building a DOM.
+  // Throws std::runtime_error for malformed JSON or mistyped fields.
+  static void parseRequest(std::string_view line, JsonRequest &request);
+};
+
+} // namespace network
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <netinet/in.h>
+#include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace network {
@@ -12,7 +15,30 @@ enum class MessageType : uint8_t {
   NEW_ORDER = 2,
   ORDER_ACK = 3,
   TRADE = 4,
-  MARKET_DATA = 5
+  MARKET_DATA = 5,
+  JOIN_ACK = 6,
+  NEW_ORDER_REF = 7,
+  NEW_ORDER_BATCH = 8,
+  ORDER_ACK_BATCH = 9,
+  CANCEL = 10,
+  REPLACE = 11
+};
+
+// Orders one NEW_ORDER_BATCH may carry, keeps the frame under the 16-bit
+// length limit
+constexpr size_t MAX_BATCH_ORDERS = 256;
+
+// Outcome of one order in an ORDER_ACK_BATCH
+enum class BatchAckStatus : uint8_t {
+  ACCEPTED = 0,
+  SESSION_NOT_FOUND = 1,
+  USER_NOT_FOUND = 2,
+  SYMBOL_NOT_FOUND = 3,
+  INSUFFICIENT_FUNDS = 4,
+  INSUFFICIENT_POSITION = 5,
+  REJECTED = 6, // refused by the book
+  INVALID_SIDE = 7,
+  INVALID_QUANTITY = 8
 };
 
 #pragma pack(push, 1)
@@ -31,18 +57,96 @@ struct JoinMessage {
 struct NewOrderMessage {
   MessageHeader header;
   uint64_t order_id;
-  uint8_t side; // 0 = buy, 1 = sell
-  double price;
+  uint8_t side;  // 0 = buy, 1 = sell
+  int64_t price; // ticks, see orderbook::PriceScale
   uint32_t quantity;
   char symbol[8];
   char session_id[32];
 };
 
+// Reply to JOIN. On success it carries the refs NEW_ORDER_REF uses in place
+// of names, followed by `symbol_count` SymbolRef entries for the session's
+// books.
+struct JoinAckMessage {
+  MessageHeader header;
+  uint8_t success;
+  uint32_t session_ref;
+  uint16_t symbol_count;
+};
+
+struct SymbolRef {
+  char symbol[8];
+  uint32_t symbol_ref;
+};
+
+// NEW_ORDER addressed by the refs from JOIN_ACK, so the server resolves the
+// book without building or hashing strings
+struct NewOrderRefMessage {
+  MessageHeader header;
+  uint64_t order_id;
+  uint8_t side;  // 0 = buy, 1 = sell
+  int64_t price; // ticks, see orderbook::PriceScale
+  uint32_t quantity;
+  uint32_t session_ref;
+  uint32_t symbol_ref;
+};
+
+// Pulls a resting order, answered with an ORDER_ACK
+struct CancelMessage {
+  MessageHeader header;
+  uint64_t order_id;
+  uint32_t session_ref;
+  uint32_t symbol_ref;
+};
+
+// Amends a resting order to a new price and open quantity in one step. It
+// keeps its queue priority if only the quantity goes down. Answered with an
+// ORDER_ACK.
+struct ReplaceMessage {
+  MessageHeader header;
+  uint64_t order_id;
+  uint8_t side;  // 0 = buy, 1 = sell, must match the resting order
+  int64_t price; // ticks, see orderbook::PriceScale
+  uint32_t quantity;
+  uint32_t session_ref;
+  uint32_t symbol_ref;
+};
+
+// Up to MAX_BATCH_ORDERS orders for one session in a single frame, followed
+// by `order_count` BatchOrder entries. Entries may name different symbols.
+struct NewOrderBatchMessage {
+  MessageHeader header;
+  uint32_t session_ref;
+  uint16_t order_count;
+};
+
+struct BatchOrder {
+  uint64_t order_id;
+  uint8_t side;  // 0 = buy, 1 = sell
+  int64_t price; // ticks, see orderbook::PriceScale
+  uint32_t quantity;
+  uint32_t symbol_ref;
+};
+
+// Reply to NEW_ORDER_BATCH, followed by one BatchAck per order in the order
+// they were sent
+struct OrderAckBatchMessage {
+  MessageHeader header;
+  uint16_t ack_count;
+};
+
+struct BatchAck {
+  uint64_t order_id;
+  BatchAckStatus status;
+  uint32_t filled_quantity;
+  uint8_t rested; // 1 if a remainder was added to the book
+};
+
 struct MarketDataMessage {
   MessageHeader header;
   char symbol[8];
-  double best_bid;
-  double best_ask;
+  int64_t best_bid; // ticks
+  int64_t best_ask; // ticks
   uint32_t bid_size;
   uint32_t ask_size;
   uint64_t timestamp;
@@ -54,13 +158,32 @@ class BinaryProtocol {
 public:
   static std::vector<uint8_t> serializeJoin(const std::string &username,
                                             const std::string &session_id);
-  static std::vector<uint8_t> serializeNewOrder(uint64_t order_id, bool is_buy,
-                                                double price, uint32_t quantity,
-                                                const std::string &symbol,
-                                                const std::string &session_id);
   static std::vector<uint8_t>
-  serializeMarketData(const std::string &symbol, double best_bid,
-                      double best_ask, uint32_t bid_size, uint32_t ask_size);
+  serializeNewOrder(uint64_t order_id, bool is_buy, int64_t price,
+                    uint32_t quantity, const std::string &symbol,
+                    const std::string &session_id);
+  static std::vector<uint8_t> serializeJoinAck(
+      bool success, uint32_t session_ref,
+      const std::vector<std::pair<std::string, uint32_t>> &symbol_refs);
+  static std::vector<uint8_t>
+  serializeNewOrderRef(uint64_t order_id, bool is_buy, int64_t price,
+                       uint32_t quantity, uint32_t session_ref,
+                       uint32_t symbol_ref);
+  static std::vector<uint8_t> serializeCancel(uint64_t order_id,
+                                              uint32_t session_ref,
+                                              uint32_t symbol_ref);
+  static std::vector<uint8_t>
+  serializeReplace(uint64_t order_id, bool is_buy, int64_t price,
+                   uint32_t quantity, uint32_t session_ref,
+                   uint32_t symbol_ref);
+  // `orders` are in host byte order. Throws std::invalid_argument for more
+  // than MAX_BATCH_ORDERS.
+  static std::vector<uint8_t>
+  serializeNewOrderBatch(uint32_t session_ref,
+                         std::span<const BatchOrder> orders);
+  static std::vector<uint8_t>
+  serializeMarketData(const std::string &symbol, int64_t best_bid,
+                      int64_t best_ask, uint32_t bid_size, uint32_t ask_size);
 
   static uint16_t hton16(uint16_t host) { return htons(host); }
   static uint32_t hton32(uint32_t host) { return htonl(host); }
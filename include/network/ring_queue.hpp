@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace network {
+
+// Bounded lock-free queue over a power-of-two ring of cells (Vyukov). Each
+// cell carries a sequence number telling producers and consumers whose turn
+// it is, so any number of threads may push and pop without a lock. Used as
+// MPSC by the shard engine. The try* calls report full and empty, push and
+// emplace yield until there is room.
+template <typename T> class RingQueue {
+public:
+  explicit RingQueue(size_t capacity) {
+    if (capacity == 0) {
+      throw std::invalid_argument("Ring capacity must be non-zero");
+    }
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    _mask = size - 1;
+    _cells = std::make_unique<Cell[]>(size);
+    for (size_t i = 0; i < size; ++i) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  RingQueue(const RingQueue &) = delete;
+  RingQueue(RingQueue &&) = delete;
+  RingQueue &operator=(const RingQueue &) = delete;
+  RingQueue &operator=(RingQueue &&) = delete;
+
+  size_t getCapacity() const { return _mask + 1; }
+
+  bool tryPush(const T &value) { return tryEmplace(value); }
+  bool tryPush(T &&value) { return tryEmplace(std::move(value)); }
+
+  void push(const T &value) { emplace(value); }
+  void push(T &&value) { emplace(std::move(value)); }
+
+  template <typename... Args> void emplace(Args &&...args) {
+    while (!tryEmplace(std::forward<Args>(args)...)) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Arguments are only consumed if there is room
+  template <typename... Args> bool tryEmplace(Args &&...args) {
+    size_t pos = _tail.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &_cells[pos & _mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = T(std::forward<Args>(args)...);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T &holder) {
+    size_t pos = _head.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &_cells[pos & _mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (_head.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // empty
+      } else {
+        pos = _head.load(std::memory_order_relaxed);
+      }
+    }
+    holder = std::move(cell->value);
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate while other threads are pushing or popping
+  bool isEmpty() const { return getSize() == 0; }
+
+  size_t getSize() const {
+    size_t head = _head.load(std::memory_order_acquire);
+    size_t tail = _tail.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  void clear() {
+    T holder;
+    while (tryPop(holder)) {
+    }
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> _cells;
+  size_t _mask{0};
+  // Producers and the consumer each get their own cache line
+  alignas(64) std::atomic<size_t> _tail{0};
+  alignas(64) std::atomic<size_t> _head{0};
+};
+
+} // namespace network
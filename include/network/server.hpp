@@ -1,5 +1,6 @@
 #pragma once
 
+#include "io_backend.hpp"
 #include <cstdint>
 #include <string>
 
@@ -15,7 +16,8 @@ namespace network {
 
 class NetworkServer {
 public:
-  NetworkServer(uint16_t port, bool use_binary_protocol = false);
+  NetworkServer(uint16_t port, bool use_binary_protocol = false,
+                IoBackendType backend = IoBackend::defaultType());
   ~NetworkServer();
 
   void start();
@@ -24,8 +26,9 @@ public:
   session::Session *getSession(const std::string &session_id);
 
   void enableMarketData(const std::string &multicast_addr, uint16_t port);
-  void publishMarketData(const std::string &symbol, double best_bid,
-                         double best_ask, uint32_t bid_size, uint32_t ask_size);
+  void publishMarketData(const std::string &symbol, int64_t best_bid,
+                         int64_t best_ask, uint32_t bid_size,
+                         uint32_t ask_size);
 
 private:
   class Impl;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ring_queue.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace network {
+
+// Runs book work on a fixed set of shard threads. Every (session, symbol)
+// book hashes to one shard, so a book is only ever touched by that shard's
+// thread and connections never contend on it. Each shard thread is pinned
+// to its own core where the platform allows, and drains an MPSC ring that
+// client handlers post tasks into.
+class ShardedEngine {
+public:
+  using Task = std::function<void()>;
+
+  explicit ShardedEngine(size_t num_shards, size_t ring_capacity = 4096);
+  ~ShardedEngine();
+
+  ShardedEngine(const ShardedEngine &) = delete;
+  ShardedEngine(ShardedEngine &&) = delete;
+  ShardedEngine &operator=(const ShardedEngine &) = delete;
+  ShardedEngine &operator=(ShardedEngine &&) = delete;
+
+  size_t shardFor(const std::string &session_id,
+                  const std::string &symbol) const;
+
+  // Returns false if the shard's ring is full or the engine has stopped
+  bool tryPost(size_t shard, Task task);
+  // Spins until the task is queued, returns false once stopped
+  bool post(size_t shard, Task task);
+
+  // Runs whatever is still queued, then joins the shard threads
+  void stop();
+  size_t getShardCount() const;
+
+private:
+  struct Shard {
+    explicit Shard(size_t ring_capacity) : ring(ring_capacity) {}
+
+    RingQueue<Task> ring;
+    std::atomic<uint32_t> signal{0}; // bumped on every post to wake the shard
+    std::thread thread;
+  };
+
+  void run(Shard &shard);
+  static void pinToCore(std::thread &thread, size_t core);
+
+  std::vector<std::unique_ptr<Shard>> _shards;
+  std::atomic<bool> _running{true};   // accepting posts
+  std::atomic<size_t> _posting{0};    // posts past the _running check
+  std::atomic<bool> _quiesced{false}; // no post can land any more
+};
+
+} // namespace network
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+
+namespace network {
+
+// Bytes read from a socket that the handler has not consumed yet. Reads
+// land straight in the free space at the back and messages are consumed
+// from the front in place. The unread bytes only move back to the start
+// when a read needs more room than is left, so consuming a message never
+// copies the rest, and a message is always contiguous. Storage is taken on
+// the first read, so an idle connection holds none.
+class StreamBuffer {
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 16 * 1024;
+
+  explicit StreamBuffer(size_t capacity = DEFAULT_CAPACITY)
+      : _capacity(capacity) {}
+
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  const uint8_t *data() const { return _storage.get() + _begin; }
+  size_t size() const { return _end - _begin; }
+  bool empty() const { return _begin == _end; }
+  size_t getCapacity() const { return _capacity; }
+  std::span<const uint8_t> readable() const { return {data(), size()}; }
+
+  // Consumed bytes stay readable until the next prepare()
+  void consume(size_t length) {
+    _begin += length;
+    if (_begin == _end) {
+      _begin = _end = 0;
+    }
+  }
+
+  void clear() { _begin = _end = 0; }
+
+  // Free space of at least `min_space` bytes to read into, then commit()
+  // what was actually written
+  std::span<uint8_t> prepare(size_t min_space) {
+    if (!_storage) {
+      _capacity = std::max(_capacity, min_space);
+      _storage = std::make_unique_for_overwrite<uint8_t[]>(_capacity);
+    } else if (_capacity - _end < min_space) {
+      size_t unread = size();
+      if (_begin > 0) {
+        std::memmove(_storage.get(), data(), unread);
+        _begin = 0;
+        _end = unread;
+      }
+      if (_capacity - _end < min_space) {
+        grow(_end + min_space);
+      }
+    }
+    return {_storage.get() + _end, _capacity - _end};
+  }
+
+  void commit(size_t length) { _end += length; }
+
+  void append(const void *bytes, size_t length) {
+    std::memcpy(prepare(length).data(), bytes, length);
+    commit(length);
+  }
+
+private:
+  void grow(size_t needed) {
+    size_t capacity = _capacity * 2;
+    while (capacity < needed) {
+      capacity *= 2;
+    }
+    auto storage = std::make_unique_for_overwrite<uint8_t[]>(capacity);
+    std::memcpy(storage.get(), _storage.get(), _end);
+    _storage = std::move(storage);
+    _capacity = capacity;
+  }
+
+  std::unique_ptr<uint8_t[]> _storage;
+  size_t _capacity;
+  size_t _begin{0}; // first unread byte
+  size_t _end{0};   // one past the last unread byte
+};
+
+} // namespace network
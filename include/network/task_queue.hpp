@@ -1,63 +1,241 @@
 #pragma once
 
-#include <mutex>
-#include <queue>
-#include <shared_mutex>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
 
 namespace network {
 
-template <typename T> class TaskQueue : protected std::queue<T> {
+// Unbounded lock-free MPMC queue built from fixed-size segments. Producers
+// claim a slot in the tail segment with one fetch_add and link a new segment
+// when it fills, consumers claim slots in the head segment with a CAS and
+// move to the next segment once it is drained. RingQueue is the bounded
+// counterpart with the same push/emplace/tryPop/getSize interface.
+//
+// A drained segment is retired rather than freed, since a thread that read
+// the old head or tail may still be inside it. Every operation is counted
+// in `_active`, and retired segments are released by whichever operation
+// leaves the queue idle. A few released segments are kept spare for
+// producers that need a new one, so a queue that keeps going idle stops
+// allocating.
+template <typename T, size_t SegmentSize = 256> class TaskQueue {
 public:
-  using writelock = std::unique_lock<std::shared_mutex>;
-  using readlock = std::shared_lock<std::shared_mutex>;
+  TaskQueue() {
+    Segment *segment = new Segment;
+    _head.store(segment, std::memory_order_relaxed);
+    _tail.store(segment, std::memory_order_relaxed);
+  }
 
-  TaskQueue() = default;
-  ~TaskQueue() { clear(); }
+  ~TaskQueue() {
+    for (auto &spare : _spares) {
+      delete spare.load(std::memory_order_relaxed);
+    }
+    Segment *retired = _retired.load(std::memory_order_relaxed);
+    while (retired) {
+      Segment *next = retired->retired_next;
+      delete retired;
+      retired = next;
+    }
+    Segment *segment = _head.load(std::memory_order_relaxed);
+    while (segment) {
+      Segment *next = segment->next.load(std::memory_order_relaxed);
+      delete segment;
+      segment = next;
+    }
+  }
 
   TaskQueue(const TaskQueue &) = delete;
   TaskQueue(TaskQueue &&) = delete;
   TaskQueue &operator=(const TaskQueue &) = delete;
   TaskQueue &operator=(TaskQueue &&) = delete;
 
-  bool isEmpty() const {
-    readlock lock(_mutex);
-    return std::queue<T>::empty();
-  }
+  // Approximate while other threads are pushing or popping
+  bool isEmpty() const { return getSize() == 0; }
 
   size_t getSize() const {
-    readlock lock(_mutex);
-    return std::queue<T>::size();
+    Guard guard(*this);
+    size_t size = 0;
+    for (Segment *segment = _head.load(std::memory_order_acquire); segment;
+         segment = segment->next.load(std::memory_order_acquire)) {
+      size_t pushed = std::min(segment->enqueue.load(), SegmentSize);
+      size_t popped = std::min(segment->dequeue.load(), SegmentSize);
+      size += pushed > popped ? pushed - popped : 0;
+    }
+    return size;
   }
 
   void clear() {
-    writelock lock(_mutex);
-    while (!std::queue<T>::empty()) {
-      std::queue<T>::pop();
+    T holder;
+    while (tryPop(holder)) {
     }
   }
 
-  void push(const T &object) {
-    writelock lock(_mutex);
-    std::queue<T>::push(object);
-  }
+  void push(const T &object) { enqueue(object); }
+  void push(T &&object) { enqueue(std::move(object)); }
 
   template <typename... Args> void emplace(Args &&...args) {
-    writelock lock(_mutex);
-    std::queue<T>::emplace(std::forward<Args>(args)...);
+    enqueue(T(std::forward<Args>(args)...));
   }
 
+  // Returns false when empty, or when the next item's producer has claimed
+  // its slot but not finished writing it
   bool tryPop(T &holder) {
-    writelock lock(_mutex);
-    if (std::queue<T>::empty()) {
-      return false;
+    Guard guard(*this);
+    while (true) {
+      Segment *head = _head.load(std::memory_order_acquire);
+      size_t index = head->dequeue.load(std::memory_order_acquire);
+
+      if (index >= SegmentSize) {
+        Segment *next = head->next.load(std::memory_order_acquire);
+        if (!next) {
+          return false;
+        }
+        // Tail must be past the segment before it becomes unreachable
+        Segment *expected = head;
+        _tail.compare_exchange_strong(expected, next);
+        if (_head.compare_exchange_strong(head, next)) {
+          retire(head);
+        }
+        continue;
+      }
+
+      Slot &slot = head->slots[index];
+      if (!slot.ready.load(std::memory_order_acquire)) {
+        return false;
+      }
+      if (head->dequeue.compare_exchange_weak(index, index + 1)) {
+        holder = std::move(slot.value);
+        return true;
+      }
     }
-    holder = std::move(std::queue<T>::front());
-    std::queue<T>::pop();
-    return true;
   }
 
 private:
-  mutable std::shared_mutex _mutex;
+  struct Slot {
+    std::atomic<bool> ready{false};
+    T value{};
+  };
+
+  struct Segment {
+    alignas(64) std::atomic<size_t> enqueue{0};
+    alignas(64) std::atomic<size_t> dequeue{0};
+    std::atomic<Segment *> next{nullptr};
+    Segment *retired_next{nullptr};
+    Slot slots[SegmentSize];
+  };
+
+  // Counts the calling operation in `_active` for its lifetime
+  class Guard {
+  public:
+    explicit Guard(const TaskQueue &queue) : _queue(queue) {
+      _queue._active.fetch_add(1);
+    }
+    ~Guard() { _queue.leave(); }
+
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+
+  private:
+    const TaskQueue &_queue;
+  };
+
+  template <typename U> void enqueue(U &&value) {
+    Guard guard(*this);
+    while (true) {
+      Segment *tail = _tail.load(std::memory_order_acquire);
+      size_t index = tail->enqueue.fetch_add(1);
+      if (index < SegmentSize) {
+        Slot &slot = tail->slots[index];
+        slot.value = std::forward<U>(value);
+        slot.ready.store(true, std::memory_order_release);
+        return;
+      }
+
+      // Full, link a new segment unless another producer already has
+      Segment *next = tail->next.load(std::memory_order_acquire);
+      if (!next) {
+        Segment *fresh = takeSpare();
+        if (tail->next.compare_exchange_strong(next, fresh)) {
+          next = fresh;
+        } else {
+          release(fresh);
+        }
+      }
+      _tail.compare_exchange_strong(tail, next);
+    }
+  }
+
+  void retire(Segment *segment) const {
+    Segment *head = _retired.load(std::memory_order_relaxed);
+    do {
+      segment->retired_next = head;
+    } while (!_retired.compare_exchange_weak(head, segment));
+  }
+
+  // Segments retired before we took them are unreachable, so only
+  // operations that were already running can hold one. If ours is the last
+  // such operation they can go, otherwise they are handed back.
+  void leave() const {
+    Segment *retired = nullptr;
+    if (_retired.load(std::memory_order_relaxed)) {
+      retired = _retired.exchange(nullptr);
+    }
+    if (_active.fetch_sub(1) == 1) {
+      releaseChain(retired);
+      return;
+    }
+    while (retired) {
+      Segment *next = retired->retired_next;
+      retire(retired);
+      retired = next;
+    }
+  }
+
+  void releaseChain(Segment *segment) const {
+    while (segment) {
+      Segment *next = segment->retired_next;
+      release(segment);
+      segment = next;
+    }
+  }
+
+  Segment *takeSpare() const {
+    for (auto &spare : _spares) {
+      if (spare.load(std::memory_order_relaxed)) {
+        if (Segment *segment = spare.exchange(nullptr)) {
+          return segment;
+        }
+      }
+    }
+    return new Segment;
+  }
+
+  // Resets an unreachable segment and keeps it spare, or frees it if the
+  // spare slots are full
+  void release(Segment *segment) const {
+    segment->enqueue.store(0, std::memory_order_relaxed);
+    segment->dequeue.store(0, std::memory_order_relaxed);
+    segment->next.store(nullptr, std::memory_order_relaxed);
+    segment->retired_next = nullptr;
+    for (auto &slot : segment->slots) {
+      slot.ready.store(false, std::memory_order_relaxed);
+      slot.value = T{};
+    }
+    for (auto &spare : _spares) {
+      Segment *expected = nullptr;
+      if (spare.compare_exchange_strong(expected, segment)) {
+        return;
+      }
+    }
+    delete segment;
+  }
+
+  alignas(64) std::atomic<Segment *> _head{nullptr};
+  alignas(64) std::atomic<Segment *> _tail{nullptr};
+  mutable std::atomic<Segment *> _retired{nullptr};
+  mutable std::atomic<Segment *> _spares[4]{};
+  mutable std::atomic<size_t> _active{0};
 };
 
 } // namespace network
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "inline_task.hpp"
 #include "task_queue.hpp"
 #include <atomic>
 #include <condition_variable>
@@ -33,17 +34,23 @@ public:
   bool isRunning() const;
   size_t getSize() const;
 
+  // Fire and forget. Callables up to InlineTask::INLINE_SIZE are queued
+  // without any allocation.
+  template <class F> void submit(F &&f) {
+    if (_hasStopped || _isCancelled) {
+      throw std::runtime_error("Thread pool has been terminated or cancelled");
+    }
+    _tasks.emplace(std::forward<F>(f));
+    wakeIdle();
+  }
+
   template <class F, class... Args>
   auto async(F &&f, Args &&...args) -> std::future<decltype(f(args...))> {
     using ReturnType = decltype(f(args...));
     using PackagedTask = std::packaged_task<ReturnType()>;
 
-    {
-      readlock lock(_mutex);
-      if (_hasStopped || _isCancelled) {
-        throw std::runtime_error(
-            "Thread pool has been terminated or cancelled");
-      }
+    if (_hasStopped || _isCancelled) {
+      throw std::runtime_error("Thread pool has been terminated or cancelled");
     }
 
     auto bindFunc = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
@@ -51,22 +58,24 @@ public:
     auto future = task->get_future();
 
     _tasks.emplace([task]() { (*task)(); });
-    _condition.notify_one();
+    wakeIdle();
     return future;
   }
 
 private:
   void spawn();
+  void wakeIdle();
   bool isRunningImpl() const;
 
   std::atomic<bool> _isInitialised{false};
   std::atomic<bool> _isCancelled{false};
   std::atomic<bool> _hasStopped{false};
+  std::atomic<size_t> _idle{0}; // workers waiting on _condition
   std::vector<std::thread> _workers;
   mutable std::shared_mutex _mutex;
   mutable std::once_flag _once;
   mutable std::condition_variable_any _condition;
-  TaskQueue<std::function<void()>> _tasks;
+  TaskQueue<InlineTask> _tasks;
 };
 
 } // namespace network
@@ -0,0 +1,42 @@
+#pragma once
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+
+#include "io_backend.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace network {
+
+// Completion-based alternative to EpollBackend, built on raw io_uring
+// syscalls. Each loop thread owns a ring with a multishot accept on the
+// listening socket, a multishot recv per client that fills buffers from a
+// registered buffer ring, and queues one send per client with replies.
+// Everything a pass over the completions produced goes to the kernel in a
+// single io_uring_enter, which also waits for the next completions.
+class UringBackend : public IoBackend {
+public:
+  // Throws std::runtime_error if the kernel lacks what the loops need
+  UringBackend(ConnectionHandler &handler, size_t num_loops);
+  ~UringBackend() override;
+
+  UringBackend(const UringBackend &) = delete;
+  UringBackend &operator=(const UringBackend &) = delete;
+
+  void start(int listen_fd) override;
+  void stop() override;
+  size_t getThreadCount() const override;
+
+private:
+  class Loop; // a ring and its clients, see uring_backend.cpp
+
+  ConnectionHandler &_handler;
+  std::atomic<bool> _running{false};
+  std::vector<std::unique_ptr<Loop>> _loops;
+};
+
+} // namespace network
+
+#endif
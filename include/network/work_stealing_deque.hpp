@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace network {
+
+// Chase-Lev deque of pointers. The owning thread pushes and pops at the
+// bottom without contention, other threads steal from the top and only race
+// each other (and the owner, for the last item) through a CAS on `_top`.
+// The ring grows on push. Replaced rings are kept until the deque goes away,
+// since a thief may still be reading from one.
+template <typename T> class WorkStealingDeque {
+public:
+  explicit WorkStealingDeque(size_t capacity = 256) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    _rings.push_back(std::make_unique<Ring>(size));
+    _ring.store(_rings.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque(WorkStealingDeque &&) = delete;
+  WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+  WorkStealingDeque &operator=(WorkStealingDeque &&) = delete;
+
+  // Owner only
+  void push(T *item) {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_acquire);
+    Ring *ring = _ring.load(std::memory_order_relaxed);
+    if (bottom - top >= static_cast<int64_t>(ring->size())) {
+      ring = grow(ring, top, bottom);
+    }
+    ring->put(bottom, item);
+    _bottom.store(bottom + 1, std::memory_order_release);
+  }
+
+  // Owner only, newest first. Returns nullptr when empty.
+  T *pop() {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    Ring *ring = _ring.load(std::memory_order_relaxed);
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = _top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T *item = ring->get(bottom);
+    if (top == bottom) {
+      // Last item, a thief may be after it too
+      if (!_top.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Any thread, oldest first. Returns nullptr when empty or when another
+  // thread took the item first.
+  T *steal() {
+    int64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = _bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+
+    Ring *ring = _ring.load(std::memory_order_acquire);
+    T *item = ring->get(top);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  // Approximate while other threads are pushing or stealing
+  bool isEmpty() const {
+    return _bottom.load(std::memory_order_acquire) <=
+           _top.load(std::memory_order_acquire);
+  }
+
+private:
+  class Ring {
+  public:
+    explicit Ring(size_t size)
+        : _mask(size - 1), _slots(std::make_unique<std::atomic<T *>[]>(size)) {
+    }
+
+    size_t size() const { return _mask + 1; }
+
+    T *get(int64_t index) const {
+      return _slots[static_cast<size_t>(index) & _mask].load(
+          std::memory_order_relaxed);
+    }
+
+    void put(int64_t index, T *item) {
+      _slots[static_cast<size_t>(index) & _mask].store(
+          item, std::memory_order_relaxed);
+    }
+
+  private:
+    size_t _mask;
+    std::unique_ptr<std::atomic<T *>[]> _slots;
+  };
+
+  Ring *grow(Ring *ring, int64_t top, int64_t bottom) {
+    auto larger = std::make_unique<Ring>(ring->size() * 2);
+    for (int64_t i = top; i < bottom; ++i) {
+      larger->put(i, ring->get(i));
+    }
+    _rings.push_back(std::move(larger));
+    _ring.store(_rings.back().get(), std::memory_order_release);
+    return _rings.back().get();
+  }
+
+  // Thieves and the owner each get their own cache line
+  alignas(64) std::atomic<int64_t> _top{0};
+  alignas(64) std::atomic<int64_t> _bottom{0};
+  std::atomic<Ring *> _ring{nullptr};
+  std::vector<std::unique_ptr<Ring>> _rings; // owner only
+};
+
+} // namespace network
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "inline_task.hpp"
+#include "ring_queue.hpp"
+#include "work_stealing_deque.hpp"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace network {
+
+// Drop-in for ThreadPool without its shared locks. Each worker owns a
+// Chase-Lev deque: tasks submitted from a worker go on its own deque, tasks
+// from other threads go through a lock-free injection ring, and a worker
+// with nothing to do steals from the others before parking.
+class WorkStealingPool {
+public:
+  using Task = InlineTask;
+
+  WorkStealingPool() = default;
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool(WorkStealingPool &&) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(WorkStealingPool &&) = delete;
+
+  void init(int num);
+  // Runs every queued task, then joins the workers
+  void terminate();
+  // Drops queued tasks, their futures report a broken promise
+  void cancel();
+  bool isInitialised() const;
+  bool isRunning() const;
+  size_t getSize() const;
+
+  // Fire and forget, no future. The task is stored inline in a node that is
+  // recycled once it has run, so a warmed-up pool submits without
+  // allocating.
+  template <class F> void submit(F &&f) {
+    if (_hasStopped.load() || _isCancelled.load()) {
+      throw std::runtime_error("Thread pool has been terminated or cancelled");
+    }
+    enqueue(makeTask(std::forward<F>(f)));
+  }
+
+  template <class F, class... Args>
+  auto async(F &&f, Args &&...args) -> std::future<decltype(f(args...))> {
+    using ReturnType = decltype(f(args...));
+    using PackagedTask = std::packaged_task<ReturnType()>;
+
+    if (_hasStopped.load() || _isCancelled.load()) {
+      throw std::runtime_error("Thread pool has been terminated or cancelled");
+    }
+
+    auto bindFunc = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+    auto task = std::make_shared<PackagedTask>(std::move(bindFunc));
+    auto future = task->get_future();
+
+    enqueue(makeTask([task]() { (*task)(); }));
+    return future;
+  }
+
+private:
+  struct Worker {
+    WorkStealingDeque<Task> deque;
+    std::thread thread;
+  };
+
+  // Reuses a spare node when there is one
+  template <class F> Task *makeTask(F &&f) {
+    Task *task = nullptr;
+    if (_spare && _spare->tryPop(task)) {
+      *task = Task(std::forward<F>(f));
+      return task;
+    }
+    return new Task(std::forward<F>(f));
+  }
+
+  // Drops the task's callable and keeps the node for the next submit
+  void recycle(Task *task);
+  void enqueue(Task *task);
+  void run(size_t index);
+  Task *findTask(size_t index);
+  void wake();
+  void join();
+  void discardQueued();
+
+  std::atomic<bool> _isInitialised{false};
+  std::atomic<bool> _isCancelled{false};
+  std::atomic<bool> _hasStopped{false};
+  std::vector<std::unique_ptr<Worker>> _workers;
+  std::unique_ptr<RingQueue<Task *>> _injected; // from non-worker threads
+  std::unique_ptr<RingQueue<Task *>> _spare;    // run nodes for reuse
+  std::atomic<uint32_t> _signal{0};   // bumped to wake parked workers
+  std::atomic<size_t> _sleeping{0};   // workers parked or about to park
+  mutable std::mutex _mutex;          // init, terminate and cancel only
+  std::once_flag _once;
+};
+
+} // namespace network
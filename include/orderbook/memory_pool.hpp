@@ -1,16 +1,214 @@
 #pragma once
 
-#include <array>
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
 #include <type_traits>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 
 namespace orderbook {
 
 // Constants for tuning
 constexpr size_t BLOCK_SIZE = 4096; // 4KB blocks
 constexpr size_t MAX_BLOCKS = 1024; // Max number of blocks to allocate
+// Nodes move between a thread's magazine and the central free list in
+// batches, and a magazine flushes a batch back once it holds more than this
+constexpr size_t MAGAZINE_BATCH = 32;
+constexpr size_t MAGAZINE_CAPACITY = 2 * MAGAZINE_BATCH;
+
+// How freed nodes get back to other threads once magazines overflow
+enum class FreeListMode {
+  MUTEX,    // central free list under the pool mutex
+  LOCK_FREE // Treiber stack updated by CAS, slab carving still locks
+};
+
+enum class PoolGrowth {
+  FIXED,    // BlockSize blocks from the heap, at most MAX_BLOCKS of them
+  GEOMETRIC // mmap'd slabs that double in size, no ceiling
+};
+
+struct PoolOptions {
+  PoolGrowth growth{PoolGrowth::FIXED};
+  FreeListMode free_list_mode{FreeListMode::MUTEX};
+  size_t initial_slab_bytes{64 * 1024};    // GEOMETRIC only
+  size_t max_slab_bytes{64 * 1024 * 1024}; // GEOMETRIC only
+  bool huge_pages{false};    // GEOMETRIC and NUMA, else ordinary pages
+  size_t reserve_objects{0}; // set up and faulted in at construction
+  bool cache_line_slots{false}; // give every object its own cache line(s)
+  bool numa_local{false};       // one arena per NUMA node, see MemoryPool
+};
+
+namespace detail {
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+constexpr size_t CACHE_LINE_SIZE = 64;
+// NUMA slabs are this size and aligned to it, so masking an object's address
+// finds its slab header and the arena that owns it
+constexpr size_t NUMA_SLAB_BYTES = 2 * 1024 * 1024;
+
+constexpr size_t round_up(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Anonymous mapping, huge pages first if asked for. Linux tries explicit
+// huge pages, then falls back to a normal mapping marked for transparent
+// huge pages. Elsewhere huge pages are not attempted.
+inline void *map_slab(size_t bytes, bool huge_pages) {
+  void *ptr = MAP_FAILED;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  if (huge_pages) {
+    ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (ptr == MAP_FAILED) {
+    ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (huge_pages) {
+      madvise(ptr, bytes, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  return ptr;
+}
 
+// Mapping of `bytes` aligned to `alignment`, by over-mapping and trimming
+inline void *map_aligned(size_t bytes, size_t alignment, bool huge_pages) {
+  size_t span = bytes + alignment;
+  void *raw = mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+
+  auto start = reinterpret_cast<uintptr_t>(raw);
+  uintptr_t aligned = round_up(start, alignment);
+  if (aligned > start) {
+    munmap(raw, aligned - start);
+  }
+  size_t tail = start + span - (aligned + bytes);
+  if (tail > 0) {
+    munmap(reinterpret_cast<void *>(aligned + bytes), tail);
+  }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (huge_pages) {
+    madvise(reinterpret_cast<void *>(aligned), bytes, MADV_HUGEPAGE);
+  }
+#else
+  (void)huge_pages;
+#endif
+  return reinterpret_cast<void *>(aligned);
+}
+
+// NUMA nodes on this machine, 1 where the platform has no notion of them
+inline size_t numa_node_count() {
+#if defined(__linux__)
+  static const size_t count = [] {
+    size_t nodes = 0;
+    while (access(("/sys/devices/system/node/node" + std::to_string(nodes))
+                      .c_str(),
+                  F_OK) == 0) {
+      nodes++;
+    }
+    return std::max<size_t>(nodes, 1);
+  }();
+  return count;
+#else
+  return 1;
+#endif
+}
+
+inline size_t current_numa_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu = 0;
+  unsigned int node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return node;
+  }
+#endif
+  return 0;
+}
+
+// Ask the kernel to place [ptr, ptr + bytes) on `node`. Best effort, where
+// this is unavailable first touch by a thread on the node does the same.
+inline void prefer_node(void *ptr, size_t bytes, size_t node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  constexpr int MPOL_PREFERRED_POLICY = 1; // MPOL_PREFERRED
+  if (node < 64) {
+    unsigned long mask = 1UL << node;
+    syscall(SYS_mbind, ptr, bytes, MPOL_PREFERRED_POLICY, &mask,
+            sizeof(mask) * 8, 0);
+  }
+#else
+  (void)ptr;
+  (void)bytes;
+  (void)node;
+#endif
+}
+
+// Touch every page so reserved memory takes no page faults when first used
+inline void prefault(void *ptr, size_t bytes) {
+  auto *bytes_ptr = static_cast<volatile std::byte *>(ptr);
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  for (size_t offset = 0; offset < bytes; offset += page_size) {
+    bytes_ptr[offset] = std::byte{0};
+  }
+}
+
+// Ids of the pools still alive, so a thread exiting after a pool has gone
+// knows to leave that pool's magazine alone. Leaked on purpose so it outlives
+// every static pool.
+struct PoolRegistry {
+  std::mutex mutex;
+  std::unordered_set<uint64_t> live;
+  uint64_t next_id{1};
+
+  static PoolRegistry &get() {
+    static auto *registry = new PoolRegistry();
+    return *registry;
+  }
+};
+
+} // namespace detail
+
+// Each thread allocates from and frees into its own magazine, a short free
+// list that needs no lock. The central free list and the blocks behind it
+// are only locked to refill an empty magazine or to drain a full one.
+//
+// Memory comes in slabs carved front to back. FIXED pools use BlockSize
+// slabs up to MAX_BLOCKS and throw past that. GEOMETRIC pools map slabs
+// that double in size up to max_slab_bytes, so they never run out, and the
+// number of new slabs needed grows only logarithmically with the live count.
+//
+// With FreeListMode::LOCK_FREE, batches leaving and refilling magazines go
+// through a Treiber stack instead of the mutex. Its head packs a 16-bit
+// modification tag above a 48-bit pointer, so a pop that read a stale next
+// pointer fails its CAS rather than corrupting the list (ABA). Nodes stay
+// mapped until the pool itself is destroyed, so the stale read is harmless.
+//
+// Slab headers are padded to a cache line so no object shares a line with
+// one, and cache_line_slots pads each object to whole lines. A numa_local
+// pool keeps one arena (slabs plus central free list) per NUMA node. Threads
+// allocate from the arena of the node they first allocate on, and an object
+// freed on another node is sent back to its own arena rather than reused
+// there. Its slabs are always NUMA_SLAB_BYTES, whatever the growth mode.
 template <typename T, size_t BlockSize = BLOCK_SIZE> class MemoryPool {
   static_assert(BlockSize >= sizeof(T), "BlockSize too small for type T");
   static_assert(BlockSize >= sizeof(void *),
@@ -18,28 +216,104 @@ template <typename T, size_t BlockSize = BLOCK_SIZE> class MemoryPool {
   static_assert(std::is_trivially_copyable_v<T>,
                 "T must be trivially copyable");
 
-  // Block structure for memory management
-  struct alignas(std::max_align_t) Block {
-    std::array<std::byte, BlockSize> data;
-    Block *next;
-    std::atomic<size_t> used_count{0};
+  struct Arena;
+
+  // Header at the front of every slab, objects follow it
+  struct Slab {
+    Slab *next;
+    size_t bytes; // whole allocation, header included
+    bool mapped;  // from mmap rather than operator new
+    Arena *arena;
   };
 
+  static constexpr size_t SLAB_HEADER =
+      detail::round_up(sizeof(Slab), detail::CACHE_LINE_SIZE);
+
   // Free list node structure
   struct FreeNode {
     FreeNode *next;
   };
 
+  // Slabs and central free list for one NUMA node, or the whole pool
+  struct alignas(detail::CACHE_LINE_SIZE) Arena {
+    size_t node{0};
+    std::mutex mutex;
+    FreeNode *free_list{nullptr};            // FreeListMode::MUTEX
+    std::atomic<uint64_t> lock_free_head{0}; // FreeListMode::LOCK_FREE
+    Slab *used_slabs{nullptr};               // carved or being carved
+    Slab *spare_slabs{nullptr}; // set up by reserve(), not yet carved
+    std::byte *current_data{nullptr};
+    size_t current_capacity{0};
+    size_t current_offset{0};
+    size_t next_slab_bytes{0};
+  };
+
+  // Owned by the pool and used by one thread at a time. When that thread
+  // exits its nodes go back to the central list and the magazine is handed
+  // to the next thread that asks.
+  struct Magazine {
+    Arena *arena{nullptr}; // arena of the thread using it
+    FreeNode *head{nullptr};
+    size_t count{0};
+    std::atomic<int64_t> active{0}; // allocations minus frees through here
+    bool abandoned{false};          // guarded by the pool mutex
+  };
+
 public:
-  MemoryPool()
-      : head_block(nullptr), free_list(nullptr), total_active_count(0) {
-    allocate_block();
+  explicit MemoryPool(const PoolOptions &options = {})
+      : options(options),
+        slot_size(options.cache_line_slots
+                      ? detail::round_up(sizeof(T), detail::CACHE_LINE_SIZE)
+                      : sizeof(T)) {
+    auto &registry = detail::PoolRegistry::get();
+    {
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      pool_id = registry.next_id++;
+      registry.live.insert(pool_id);
+    }
+
+    size_t num_arenas = options.numa_local ? detail::numa_node_count() : 1;
+    for (size_t node = 0; node < num_arenas; ++node) {
+      auto arena = std::make_unique<Arena>();
+      arena->node = node;
+      arena->next_slab_bytes = options.initial_slab_bytes;
+      arenas.push_back(std::move(arena));
+    }
+
+    allocate_block(home_arena());
+    if (options.reserve_objects > 0) {
+      reserve(options.reserve_objects);
+    }
+  }
+
+  // Sets up and faults in enough memory that `count` more objects can be
+  // carved in the calling thread's arena without setting up a slab on the
+  // allocation path
+  void reserve(size_t count) {
+    Arena &arena = home_arena();
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    size_t available = arena.current_capacity - arena.current_offset;
+    for (Slab *slab = arena.spare_slabs; slab != nullptr; slab = slab->next) {
+      available += slab->bytes - SLAB_HEADER;
+    }
+    size_t needed = count * slot_size;
+    while (available < needed) {
+      Slab *slab = new_slab(arena, needed - available);
+      detail::prefault(data_of(slab), slab->bytes - SLAB_HEADER);
+      slab->next = arena.spare_slabs;
+      arena.spare_slabs = slab;
+      available += slab->bytes - SLAB_HEADER;
+    }
   }
 
   // Allocate and construct object
   template <typename... Args> T *allocate(Args &&...args) {
-    void *ptr = allocate_raw();
-    total_active_count.fetch_add(1, std::memory_order_release);
+    Magazine *magazine = local_magazine();
+    void *ptr = magazine->head ? pop(magazine) : refill(magazine);
+    // Only the owning thread writes its counter, no locked add needed
+    magazine->active.store(magazine->active.load(std::memory_order_relaxed) +
+                               1,
+                           std::memory_order_relaxed);
     return new (ptr) T(std::forward<Args>(args)...);
   }
 
@@ -51,81 +325,338 @@ public:
     // Call destructor
     ptr->~T();
 
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-      // Add to free list
-      auto *node = reinterpret_cast<FreeNode *>(ptr);
-      node->next = free_list;
-      free_list = node;
+    Magazine *magazine = local_magazine();
+    magazine->active.store(magazine->active.load(std::memory_order_relaxed) -
+                               1,
+                           std::memory_order_relaxed);
+
+    auto *node = reinterpret_cast<FreeNode *>(ptr);
+    if (arenas.size() > 1) {
+      Arena *owner = owner_of(node);
+      if (owner != magazine->arena) {
+        return_nodes(*owner, node, node);
+        return;
+      }
     }
 
-    total_active_count.fetch_sub(1, std::memory_order_release);
+    push(magazine, node);
+    if (magazine->count > MAGAZINE_CAPACITY) {
+      give_back(magazine, MAGAZINE_BATCH);
+    }
   }
 
   ~MemoryPool() {
-    Block *current = head_block;
-    while (current != nullptr) {
-      Block *next = current->next;
-      delete current;
-      current = next;
+    {
+      auto &registry = detail::PoolRegistry::get();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.live.erase(pool_id);
+    }
+
+    for (auto &arena : arenas) {
+      free_slabs(arena->used_slabs);
+      free_slabs(arena->spare_slabs);
     }
   }
 
   // Statistics
   size_t get_allocated_block_count() const {
-    size_t count = 0;
-    Block *current = head_block;
-    while (current != nullptr) {
-      count++;
-      current = current->next;
-    }
-    return count;
+    return slab_count.load(std::memory_order_relaxed);
   }
 
   size_t get_active_object_count() const {
-    return total_active_count.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t total = 0;
+    for (const auto &magazine : magazines) {
+      total += magazine->active.load(std::memory_order_relaxed);
+    }
+    return static_cast<size_t>(total);
   }
 
+  size_t get_arena_count() const { return arenas.size(); }
+  size_t get_slot_size() const { return slot_size; }
+
 private:
-  void allocate_block() {
-    if (get_allocated_block_count() >= MAX_BLOCKS) {
-      throw std::runtime_error("Maximum block count exceeded");
+  struct CacheEntry {
+    uint64_t pool_id;
+    MemoryPool *pool;
+    Magazine *magazine;
+  };
+
+  // This thread's magazines, one per pool it has touched
+  struct ThreadCache {
+    uint64_t last_id{0};
+    Magazine *last{nullptr};
+    std::vector<CacheEntry> entries;
+
+    ~ThreadCache() {
+      auto &registry = detail::PoolRegistry::get();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      for (const auto &entry : entries) {
+        if (registry.live.count(entry.pool_id)) {
+          entry.pool->release_magazine(entry.magazine);
+        }
+      }
+    }
+  };
+
+  static ThreadCache &thread_cache() {
+    thread_local ThreadCache cache;
+    return cache;
+  }
+
+  Arena &home_arena() {
+    if (arenas.size() == 1) {
+      return *arenas[0];
+    }
+    return *arenas[detail::current_numa_node() % arenas.size()];
+  }
+
+  static Arena *owner_of(FreeNode *node) {
+    auto address = reinterpret_cast<uintptr_t>(node);
+    return reinterpret_cast<Slab *>(address & ~(detail::NUMA_SLAB_BYTES - 1))
+        ->arena;
+  }
+
+  Magazine *local_magazine() {
+    ThreadCache &cache = thread_cache();
+    if (cache.last_id == pool_id) {
+      return cache.last;
     }
 
-    auto *new_block = new Block();
-    new_block->next = head_block;
-    head_block = new_block;
-    current_offset = 0;
+    Magazine *magazine = nullptr;
+    for (const auto &entry : cache.entries) {
+      if (entry.pool_id == pool_id) {
+        magazine = entry.magazine;
+        break;
+      }
+    }
+    if (!magazine) {
+      magazine = adopt_magazine();
+      cache.entries.push_back({pool_id, this, magazine});
+    }
+    cache.last_id = pool_id;
+    cache.last = magazine;
+    return magazine;
+  }
+
+  Magazine *adopt_magazine() {
+    Arena *arena = &home_arena();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &magazine : magazines) {
+      if (magazine->abandoned) {
+        magazine->abandoned = false;
+        magazine->arena = arena;
+        return magazine.get();
+      }
+    }
+    magazines.push_back(std::make_unique<Magazine>());
+    magazines.back()->arena = arena;
+    return magazines.back().get();
   }
 
-  void *allocate_raw() {
+  void release_magazine(Magazine *magazine) {
+    give_back(magazine, magazine->count);
     std::lock_guard<std::mutex> lock(mutex);
+    magazine->abandoned = true;
+  }
 
-    // Try to reuse from free list first
-    if (free_list != nullptr) {
-      void *ptr = free_list;
-      free_list = free_list->next;
-      return ptr;
+  static void *pop(Magazine *magazine) {
+    FreeNode *node = magazine->head;
+    magazine->head = node->next;
+    magazine->count--;
+    return node;
+  }
+
+  static void push(Magazine *magazine, void *ptr) {
+    auto *node = static_cast<FreeNode *>(ptr);
+    node->next = magazine->head;
+    magazine->head = node;
+    magazine->count++;
+  }
+
+  static constexpr int TAG_SHIFT = 48;
+  static constexpr uint64_t POINTER_MASK = (uint64_t{1} << TAG_SHIFT) - 1;
+  static_assert(sizeof(void *) == 8, "Tagged free list needs 64-bit pointers");
+
+  static uint64_t tagged(FreeNode *node, uint64_t previous) {
+    uint64_t tag = (previous >> TAG_SHIFT) + 1;
+    return (tag << TAG_SHIFT) | reinterpret_cast<uintptr_t>(node);
+  }
+
+  static FreeNode *untagged(uint64_t head) {
+    return reinterpret_cast<FreeNode *>(head & POINTER_MASK);
+  }
+
+  // Links first..last in on top of the stack with a single CAS
+  static void push_lock_free(Arena &arena, FreeNode *first, FreeNode *last) {
+    uint64_t head = arena.lock_free_head.load(std::memory_order_relaxed);
+    do {
+      last->next = untagged(head);
+    } while (!arena.lock_free_head.compare_exchange_weak(
+        head, tagged(first, head), std::memory_order_release,
+        std::memory_order_relaxed));
+  }
+
+  static FreeNode *pop_lock_free(Arena &arena) {
+    uint64_t head = arena.lock_free_head.load(std::memory_order_acquire);
+    while (FreeNode *node = untagged(head)) {
+      // May be stale if another thread popped `node` meanwhile, the tag
+      // then makes this CAS fail
+      FreeNode *next = node->next;
+      if (arena.lock_free_head.compare_exchange_weak(
+              head, tagged(next, head), std::memory_order_acquire,
+              std::memory_order_acquire)) {
+        return node;
+      }
     }
+    return nullptr;
+  }
 
-    // If current block is full, allocate new block
-    if (current_offset + sizeof(T) > BlockSize) {
-      allocate_block();
+  // Puts the chain first..last on the arena's central list
+  void return_nodes(Arena &arena, FreeNode *first, FreeNode *last) {
+    if (options.free_list_mode == FreeListMode::LOCK_FREE) {
+      push_lock_free(arena, first, last);
+      return;
     }
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    last->next = arena.free_list;
+    arena.free_list = first;
+  }
 
-    // Allocate from current block
-    void *ptr = &head_block->data[current_offset];
-    current_offset += sizeof(T);
-    head_block->used_count.fetch_add(1, std::memory_order_release);
+  // Hands up to `count` nodes from the magazine back to the central list
+  void give_back(Magazine *magazine, size_t count) {
+    FreeNode *first = magazine->head;
+    FreeNode *last = nullptr;
+    size_t moved = 0;
+    for (FreeNode *node = first; node != nullptr && moved < count;
+         node = node->next) {
+      last = node;
+      moved++;
+    }
+    if (moved == 0) {
+      return;
+    }
+    magazine->head = last->next;
+    magazine->count -= moved;
+    return_nodes(*magazine->arena, first, last);
+  }
+
+  // Takes up to a batch of nodes, reusing freed ones before carving new ones
+  // from the current block. Only throws if not even one node is available.
+  void *refill(Magazine *magazine) {
+    Arena &arena = *magazine->arena;
+    if (options.free_list_mode == FreeListMode::LOCK_FREE) {
+      for (size_t taken = 0; taken < MAGAZINE_BATCH; ++taken) {
+        FreeNode *node = pop_lock_free(arena);
+        if (node == nullptr) {
+          break;
+        }
+        push(magazine, node);
+      }
+      if (magazine->head != nullptr) {
+        return pop(magazine);
+      }
+    }
 
-    return ptr;
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    for (size_t taken = 0; taken < MAGAZINE_BATCH; ++taken) {
+      if (arena.free_list != nullptr) {
+        void *ptr = arena.free_list;
+        arena.free_list = arena.free_list->next;
+        push(magazine, ptr);
+        continue;
+      }
+
+      if (arena.current_offset + slot_size > arena.current_capacity) {
+        if (taken > 0) {
+          break;
+        }
+        allocate_block(arena);
+      }
+
+      void *ptr = arena.current_data + arena.current_offset;
+      arena.current_offset += slot_size;
+      push(magazine, ptr);
+    }
+    return pop(magazine);
   }
 
-  Block *head_block;
-  FreeNode *free_list;
-  size_t current_offset{0};
-  std::mutex mutex;
-  std::atomic<size_t> total_active_count{0};
+  // Makes a fresh slab current, preferring one set aside by reserve()
+  void allocate_block(Arena &arena) {
+    Slab *slab = arena.spare_slabs;
+    if (slab != nullptr) {
+      arena.spare_slabs = slab->next;
+    } else {
+      slab = new_slab(arena, options.growth == PoolGrowth::FIXED
+                                 ? BlockSize
+                                 : arena.next_slab_bytes);
+      if (options.growth == PoolGrowth::GEOMETRIC) {
+        arena.next_slab_bytes =
+            std::min(arena.next_slab_bytes * 2, options.max_slab_bytes);
+      }
+    }
+
+    slab->next = arena.used_slabs;
+    arena.used_slabs = slab;
+    arena.current_data = data_of(slab);
+    arena.current_capacity = slab->bytes - SLAB_HEADER;
+    arena.current_offset = 0;
+  }
+
+  // At least `data_bytes` of object storage. FIXED and NUMA slabs have a
+  // set size, so a larger request is left to the caller's loop.
+  Slab *new_slab(Arena &arena, size_t data_bytes) {
+    void *memory;
+    size_t bytes;
+    bool mapped = options.numa_local || options.growth == PoolGrowth::GEOMETRIC;
+    if (options.numa_local) {
+      bytes = detail::NUMA_SLAB_BYTES;
+      memory = detail::map_aligned(bytes, detail::NUMA_SLAB_BYTES,
+                                   options.huge_pages);
+      detail::prefer_node(memory, bytes, arena.node);
+    } else if (!mapped) {
+      if (slab_count.load(std::memory_order_relaxed) >= MAX_BLOCKS) {
+        throw std::runtime_error("Maximum block count exceeded");
+      }
+      bytes = SLAB_HEADER + BlockSize;
+      memory =
+          ::operator new(bytes, std::align_val_t{detail::CACHE_LINE_SIZE});
+    } else {
+      size_t page = options.huge_pages
+                        ? detail::HUGE_PAGE_SIZE
+                        : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+      bytes = detail::round_up(SLAB_HEADER + std::max(data_bytes, slot_size),
+                               page);
+      memory = detail::map_slab(bytes, options.huge_pages);
+    }
+
+    slab_count.fetch_add(1, std::memory_order_relaxed);
+    return new (memory) Slab{nullptr, bytes, mapped, &arena};
+  }
+
+  static std::byte *data_of(Slab *slab) {
+    return reinterpret_cast<std::byte *>(slab) + SLAB_HEADER;
+  }
+
+  static void free_slabs(Slab *slab) {
+    while (slab != nullptr) {
+      Slab *next = slab->next;
+      if (slab->mapped) {
+        munmap(slab, slab->bytes);
+      } else {
+        ::operator delete(slab, std::align_val_t{detail::CACHE_LINE_SIZE});
+      }
+      slab = next;
+    }
+  }
+
+  uint64_t pool_id{0};
+  PoolOptions options;
+  size_t slot_size;
+  std::vector<std::unique_ptr<Arena>> arenas; // one per NUMA node, else one
+  std::atomic<size_t> slab_count{0};
+  mutable std::mutex mutex; // guards magazines
+  std::vector<std::unique_ptr<Magazine>> magazines;
 };
 
 } // namespace orderbook
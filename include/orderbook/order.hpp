@@ -1,24 +1,29 @@
 #pragma once
 
+#include "price.hpp"
 #include <cstddef>
 #include <cstdint>
 
 namespace orderbook {
 
 class OrderAllocator;
+class OrderBook;
 template <typename, size_t> class MemoryPool;
 
 enum class Side { BUY, SELL };
 
 class Order {
   friend class OrderAllocator;
+  friend class OrderBook;
   template <typename T, size_t S> friend class MemoryPool;
 
 public:
   uint64_t getId() const;
   Side getSide() const;
-  double getPrice() const;
+  Price getPrice() const;
   uint32_t getQuantity() const;
+  uint32_t getLeavesQuantity() const; // quantity still open after fills
+  uint32_t getOwner() const; // whoever may amend it, 0 when unowned
 
   // Allow copy/move for STL containers
   Order(const Order &) = default;
@@ -27,11 +32,18 @@ public:
   Order &operator=(Order &&) = default;
 
 private:
-  Order(uint64_t id, Side side, double price, uint32_t quantity);
+  Order(uint64_t id, Side side, Price price, uint32_t quantity,
+        uint32_t owner = 0);
   uint64_t _id;
   Side _side;
-  double _price;
+  uint32_t _owner; // fits the padding ahead of _price
+  Price _price;
   uint32_t _quantity;
+  uint32_t _leaves_quantity;
+
+  // Intrusive links for the price level FIFO while the order rests in a book
+  Order *_prev{nullptr};
+  Order *_next{nullptr};
 };
 
 } // namespace orderbook
@@ -7,13 +7,16 @@ namespace orderbook {
 
 class OrderAllocator {
 public:
-  static Order *create(uint64_t id, Side side, double price,
-                       uint32_t quantity) {
-    return pool.allocate(id, side, price, quantity);
+  static Order *create(uint64_t id, Side side, Price price, uint32_t quantity,
+                       uint32_t owner = 0) {
+    return pool.allocate(id, side, price, quantity, owner);
   }
 
   static void destroy(Order *order) { pool.deallocate(order); }
 
+  // Set aside room for `count` more orders ahead of a burst
+  static void reserve(size_t count) { pool.reserve(count); }
+
   static size_t get_allocated_block_count() {
     return pool.get_allocated_block_count();
   }
@@ -23,7 +26,8 @@ public:
   }
 
 private:
-  static inline MemoryPool<Order> pool;
+  // Grows without a ceiling, so resting orders are never refused
+  static inline MemoryPool<Order> pool{PoolOptions{PoolGrowth::GEOMETRIC}};
 };
 
 } // namespace orderbook
@@ -1,19 +1,119 @@
 #pragma once
 
 #include "order.hpp"
+#include "price.hpp"
+#include <cstddef>
+#include <functional>
 #include <optional>
+#include <span>
 
 namespace orderbook {
 
+// Price band and tick size for symbols traded on the array-indexed ladder,
+// all in ticks. Prices must lie on the tick grid within [min_price,
+// max_price].
+struct LadderConfig {
+  Price tick_size;
+  Price min_price;
+  Price max_price;
+};
+
+// One execution between a resting (maker) and an incoming (taker) order
+struct Fill {
+  uint64_t maker_id;
+  uint64_t taker_id;
+  Price price;
+  uint32_t quantity;
+};
+
+struct MatchResult {
+  bool accepted{false}; // false if the order could never rest here
+  bool rested{false};   // remainder was added to the book
+  size_t fill_count{0};
+  uint32_t filled_quantity{0};
+  uint32_t remaining_quantity{0};
+};
+
+// Consistent top-of-book snapshot in ticks, a side reads 0 when empty
+struct TopOfBook {
+  Price best_bid{0};
+  Price best_ask{0};
+  uint64_t bid_size{0};
+  uint64_t ask_size{0};
+};
+
+// LOCKED books serialise every caller on an internal mutex. A SINGLE_WRITER
+// book is owned by one thread which alone may call the mutating and depth
+// methods; other threads hand it work through post() and read the top of
+// book, which never touches the writer's lock in either mode.
+enum class WriterMode { LOCKED, SINGLE_WRITER };
+
+enum class BookCommandType : uint8_t { ADD, MATCH, CANCEL };
+
+// A mutation queued for the owning thread, order fields unused by CANCEL.
+// `owner` is the order's owner for an ADD and the one a CANCEL must match.
+struct BookCommand {
+  BookCommandType type;
+  uint64_t order_id;
+  Side side;
+  Price price;
+  uint32_t quantity;
+  uint32_t owner{0};
+};
+
+// Called by drain() once per command. For CANCEL only `accepted` is set,
+// telling whether the order was found.
+using BookCommandHandler =
+    std::function<void(const BookCommand &, const MatchResult &)>;
+
 class OrderBook {
 public:
-  OrderBook();
+  explicit OrderBook(const PriceScale &scale = {},
+                     WriterMode mode = WriterMode::LOCKED);
+  explicit OrderBook(const LadderConfig &ladder, const PriceScale &scale = {},
+                     WriterMode mode = WriterMode::LOCKED);
   ~OrderBook();
   bool addOrder(const Order &order);
-  bool cancelOrder(uint64_t orderId);
+  // Cancels and replaces only reach an order when `owner` is the one it was
+  // added with, so a book whose orders carry no owner needs none
+  bool cancelOrder(uint64_t orderId, uint32_t owner = 0);
   std::optional<Order> matchOrder(const Order &order);
-  double getBestBid() const;
-  double getBestAsk() const;
+
+  // Sweep as many levels as the order crosses, writing one Fill per resting
+  // order hit into `fills`. addOrder rests whatever is left, matchOrder drops
+  // it. If `fills` runs out while the order still crosses, the sweep stops
+  // there and the remainder is returned unrested. An order with no quantity
+  // is not accepted.
+  MatchResult addOrder(const Order &order, std::span<Fill> fills);
+  MatchResult matchOrder(const Order &order, std::span<Fill> fills);
+
+  // Amends a resting order in one step, `quantity` being its new open
+  // quantity. Lowering only the quantity keeps the order's place in the
+  // queue. A new price or a larger quantity re-enters it behind the orders
+  // already resting, sweeping first like addOrder if it now crosses. Not
+  // accepted, and the order left as it was, if no order with the id and
+  // owner rests on `side`, the quantity is 0 or the new price cannot rest in
+  // this book.
+  MatchResult replaceOrder(uint64_t orderId, Side side, Price price,
+                           uint32_t quantity, std::span<Fill> fills,
+                           uint32_t owner = 0);
+
+  // Queue a command from any thread for the owner to apply in drain()
+  void post(const BookCommand &command);
+  // Apply queued commands in arrival order, returns how many were applied
+  size_t drain(const BookCommandHandler &handler = {});
+
+  // Read from the published snapshot without locking the book
+  TopOfBook getTopOfBook() const;
+  Price getBestBid() const;
+  Price getBestAsk() const;
+  // Open quantity resting at the best level, 0 when that side is empty
+  uint64_t getBestBidSize() const;
+  uint64_t getBestAskSize() const;
+  // Open quantity resting at `price` on `side`
+  uint64_t getDepth(Side side, Price price) const;
+  WriterMode getWriterMode() const;
+  const PriceScale &getPriceScale() const;
   void clear();
 
 private:
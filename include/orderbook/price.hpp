@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace orderbook {
+
+// Prices are carried as integer ticks everywhere past the JSON edge, so level
+// identity never depends on floating point rounding
+using Price = int64_t;
+
+constexpr int64_t DEFAULT_TICKS_PER_UNIT = 10000; // 4 decimal places
+
+// Per-symbol fixed-point scale, converts between ticks and display prices
+struct PriceScale {
+  int64_t ticks_per_unit{DEFAULT_TICKS_PER_UNIT};
+
+  Price toTicks(double price) const {
+    return static_cast<Price>(std::llround(price * ticks_per_unit));
+  }
+
+  double toDouble(Price ticks) const {
+    return static_cast<double>(ticks) / ticks_per_unit;
+  }
+};
+
+} // namespace orderbook
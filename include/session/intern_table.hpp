@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace session {
+
+// Hands out dense numeric refs for objects that live as long as the table's
+// owner and are never removed. Looking a ref up is a bounds check and one
+// acquire load, with no lock or hashing, so it is safe from any thread while
+// another adds. Adds must be serialised by the owner.
+template <typename T, size_t Capacity> class InternTable {
+public:
+  static constexpr uint32_t NO_REF = std::numeric_limits<uint32_t>::max();
+
+  // Returns NO_REF once the table is full
+  uint32_t add(T *item) {
+    uint32_t ref = _size.load(std::memory_order_relaxed);
+    if (ref >= Capacity) {
+      return NO_REF;
+    }
+    _items[ref].store(item, std::memory_order_release);
+    _size.store(ref + 1, std::memory_order_release);
+    return ref;
+  }
+
+  // Null for a ref that was never handed out
+  T *find(uint32_t ref) const {
+    if (ref >= Capacity) {
+      return nullptr;
+    }
+    return _items[ref].load(std::memory_order_acquire);
+  }
+
+  size_t getSize() const { return _size.load(std::memory_order_acquire); }
+
+private:
+  std::array<std::atomic<T *>, Capacity> _items{};
+  std::atomic<uint32_t> _size{0};
+};
+
+} // namespace session
@@ -1,18 +1,44 @@
 #pragma once
 
 #include "../orderbook/orderbook.hpp"
+#include "intern_table.hpp"
 #include "user.hpp"
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+namespace network {
+class ThreadPool;
+} // namespace network
+
 namespace session {
 
 class Session {
 public:
-  Session(const std::string &session_id);
+  static constexpr size_t MAX_SYMBOLS = 256;
+
+  // Picks the matching shard for a (session, symbol) book
+  using ShardPlacer =
+      std::function<size_t(const std::string &, const std::string &)>;
+
+  // A book, its symbol and its shard, reachable by the symbol ref handed out
+  // at JOIN
+  struct Listing {
+    std::string symbol;
+    orderbook::OrderBook *book;
+    size_t shard;
+  };
+
+  // Books never own threads. Parallel work for this session's books runs on
+  // `executor`, which may be shared across sessions and may be null. Each
+  // listed book is placed once by `placer`, or on shard 0 without one.
+  Session(const std::string &session_id,
+          std::shared_ptr<network::ThreadPool> executor = nullptr,
+          ShardPlacer placer = nullptr);
   ~Session();
 
   // User management
@@ -26,20 +52,39 @@ public:
   const std::string &getSessionId() const;
   size_t getUserCount() const;
   bool isActive() const;
+  network::ThreadPool *getExecutor() const;
 
   // Orderbook management
-  void createOrderBook(const std::string &symbol);
+  void createOrderBook(const std::string &symbol,
+                       const orderbook::PriceScale &scale = {});
+  void createOrderBook(const std::string &symbol,
+                       const orderbook::LadderConfig &ladder,
+                       const orderbook::PriceScale &scale = {});
   orderbook::OrderBook *getOrderBook(const std::string &symbol);
   std::vector<std::string> getAvailableSymbols() const;
 
+  // Interned symbols. Each book gets a ref when it is created, resolving one
+  // takes no lock.
+  uint32_t getSymbolRef(const std::string &symbol) const;
+  const Listing *getListing(uint32_t symbol_ref) const;
+  std::vector<std::pair<std::string, uint32_t>> getSymbolRefs() const;
+
 private:
+  void listBook(const std::string &symbol);
+
   std::string _session_id;
   std::unordered_map<std::string, std::shared_ptr<User>>
       _users; // username -> User
   std::unordered_map<int, std::string>
       _socket_to_username; // socket_fd -> username
+  std::unordered_map<std::string, uint32_t>
+      _owner_ids; // username -> owner id, never forgotten
   std::unordered_map<std::string, std::unique_ptr<orderbook::OrderBook>>
       _orderbooks; // symbol -> OrderBook
+  std::vector<std::unique_ptr<Listing>> _listings; // indexed by symbol ref
+  InternTable<const Listing, MAX_SYMBOLS> _listing_refs;
+  std::shared_ptr<network::ThreadPool> _executor;
+  ShardPlacer _placer;
   mutable std::mutex _mutex;
   bool _active;
 };
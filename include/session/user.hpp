@@ -10,12 +10,14 @@ namespace session {
 
 class User {
 public:
-  User(std::string username, int socket_fd);
+  User(std::string username, int socket_fd, uint32_t owner_id = 0);
   ~User();
 
   // Getters
   const std::string &getUsername() const;
   int getSocketFd() const;
+  // Tags this user's orders in the books, the same every time they join
+  uint32_t getOwnerId() const;
   double getBalance() const;
 
   // Trade related
@@ -32,6 +34,7 @@ public:
 private:
   std::string _username;
   int _socket_fd;
+  uint32_t _owner_id;
   double _balance;
   bool _active;
   std::unordered_map<std::string, uint32_t> _positions; // symbol -> quantity
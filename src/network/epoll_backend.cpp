@@ -0,0 +1,314 @@
+#include "../../include/network/epoll_backend.hpp"
+
+#if defined(__linux__)
+
+#include "../../include/network/zero_copy.hpp"
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace network {
+
+namespace {
+
+constexpr int MAX_EVENTS = 256;
+// Smallest free space a read goes into, the input buffer grows past it
+constexpr size_t MIN_READ = 4096;
+
+// epoll_event::data.ptr of the listening socket. A loop's wake fd is tagged
+// with the loop itself and every client with its Connection.
+void *const LISTENER_TAG = nullptr;
+
+} // namespace
+
+EpollBackend::EpollBackend(ConnectionHandler &handler, size_t num_loops)
+    : _handler(handler) {
+  if (num_loops == 0) {
+    throw std::invalid_argument("Epoll backend needs at least one loop");
+  }
+  for (size_t i = 0; i < num_loops; ++i) {
+    auto loop = std::make_unique<Loop>();
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop->epoll_fd < 0 || loop->wake_fd < 0) {
+      throw std::runtime_error("Failed to create event loop");
+    }
+    epoll_event wake{};
+    wake.events = EPOLLIN;
+    wake.data.ptr = loop.get();
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &wake);
+    _loops.push_back(std::move(loop));
+  }
+}
+
+EpollBackend::~EpollBackend() {
+  stop();
+  for (auto &loop : _loops) {
+    close(loop->wake_fd);
+    close(loop->epoll_fd);
+  }
+}
+
+void EpollBackend::start(int listen_fd) {
+  if (_running.exchange(true)) {
+    return;
+  }
+  _listen_fd = listen_fd;
+  fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+  for (auto &loop : _loops) {
+    // Level-triggered, EPOLLEXCLUSIVE wakes one loop per new client
+    epoll_event accept_event{};
+    accept_event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    accept_event.data.ptr = LISTENER_TAG;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, listen_fd, &accept_event) <
+        0) {
+      throw std::runtime_error("Failed to watch listening socket");
+    }
+  }
+  for (auto &loop : _loops) {
+    loop->thread = std::thread(&EpollBackend::run, this, std::ref(*loop));
+  }
+}
+
+void EpollBackend::stop() {
+  if (!_running.exchange(false)) {
+    return;
+  }
+  for (auto &loop : _loops) {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(loop->wake_fd, &one, sizeof(one));
+  }
+  for (auto &loop : _loops) {
+    if (loop->thread.joinable()) {
+      loop->thread.join();
+    }
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, _listen_fd, nullptr);
+  }
+}
+
+size_t EpollBackend::getThreadCount() const { return _loops.size(); }
+
+void EpollBackend::run(Loop &loop) {
+  std::array<epoll_event, MAX_EVENTS> events;
+
+  while (_running.load(std::memory_order_acquire)) {
+    int ready = epoll_wait(loop.epoll_fd, events.data(), MAX_EVENTS, -1);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+      break;
+    }
+
+    // Resumes wait for the end of the batch, they may close a connection
+    // that still has an event further on
+    bool woken = false;
+    for (int i = 0; i < ready; ++i) {
+      void *tag = events[i].data.ptr;
+      if (tag == &loop) {
+        woken = true; // by a resume or by stop()
+        continue;
+      }
+      if (tag == LISTENER_TAG) {
+        acceptClients(loop);
+        continue;
+      }
+
+      auto &connection = *static_cast<Connection *>(tag);
+      uint32_t flags = events[i].events;
+      bool open = true;
+      if (flags & EPOLLIN) {
+        open = readInput(connection);
+      }
+      if (open && (flags & (EPOLLERR | EPOLLHUP))) {
+        open = false;
+      }
+      // Replies to the last messages are still sent to a half-closed peer
+      if (!connection.output.empty() && !flushOutput(connection)) {
+        open = false;
+      }
+      if (!open) {
+        closeConnection(loop, connection);
+      }
+    }
+    if (woken) {
+      resumeConnections(loop);
+    }
+  }
+
+  // Connections still open when the server stops
+  while (!loop.connections.empty()) {
+    closeConnection(loop, *loop.connections.begin()->second);
+  }
+  // Work still out for closed connections refers to them until it is done
+  while (!loop.orphans.empty()) {
+    pollfd wake{loop.wake_fd, POLLIN, 0};
+    poll(&wake, 1, -1);
+    resumeConnections(loop);
+  }
+}
+
+void EpollBackend::Loop::resume(Connection &connection) {
+  if (resumed.push(connection)) {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(wake_fd, &one, sizeof(one));
+  }
+}
+
+// Hands each resumed connection back to the handler, then reads what it
+// held off reading while suspended
+void EpollBackend::resumeConnections(Loop &loop) {
+  uint64_t wakes;
+  [[maybe_unused]] ssize_t drained = read(loop.wake_fd, &wakes, sizeof(wakes));
+
+  Connection *next = loop.resumed.takeAll();
+  while (next) {
+    Connection &connection = *next;
+    next = connection.next_resumed; // the handler may queue it again
+    connection.suspended = false;
+    if (connection.fd < 0) {
+      loop.orphans.erase(&connection);
+      continue;
+    }
+
+    bool open = true;
+    try {
+      _handler.onResumed(connection);
+    } catch (const std::exception &e) {
+      std::cerr << "Client handler error: " << e.what() << std::endl;
+      open = false;
+    }
+    if (open) {
+      open = readInput(connection);
+    }
+    if (open && !connection.output.empty()) {
+      open = flushOutput(connection);
+    }
+    if (!open) {
+      closeConnection(loop, connection);
+    }
+  }
+}
+
+void EpollBackend::acceptClients(Loop &loop) {
+  while (true) {
+    int fd = accept4(_listen_fd, nullptr, nullptr,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        std::cerr << "Failed to accept connection: " << strerror(errno)
+                  << std::endl;
+      }
+      return;
+    }
+
+    if (!SocketOptimiser::optimiseSocket(fd)) {
+      std::cerr << "Failed to optimise client socket" << std::endl;
+      close(fd);
+      continue;
+    }
+
+    auto connection = std::make_unique<Connection>(fd, &loop);
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = connection.get();
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      continue;
+    }
+    loop.connections.emplace(fd, std::move(connection));
+  }
+}
+
+// Edge-triggered, so read until the socket is drained. A read that fills
+// the buffer goes to the handler before the next, so a flood of pipelined
+// messages is consumed as it arrives rather than growing the buffer. A
+// suspended connection stops there, resuming it reads the rest.
+bool EpollBackend::readInput(Connection &connection) {
+  bool open;
+  while (true) {
+    if (connection.suspended) {
+      return true;
+    }
+    auto space = connection.input.prepare(MIN_READ);
+    ssize_t bytes = read(connection.fd, space.data(), space.size());
+    if (bytes > 0) {
+      connection.input.commit(bytes);
+      bool filled = static_cast<size_t>(bytes) == space.size();
+      if (filled && !dispatch(connection)) {
+        return false;
+      }
+      continue;
+    }
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    // Zero is the peer closing, whatever it sent first is still handled
+    open = bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    break;
+  }
+  return dispatch(connection) && open;
+}
+
+bool EpollBackend::dispatch(Connection &connection) {
+  if (connection.input.empty() || connection.suspended) {
+    return true;
+  }
+  try {
+    _handler.onReadable(connection);
+    return true;
+  } catch (const std::exception &e) {
+    std::cerr << "Client handler error: " << e.what() << std::endl;
+    return false;
+  }
+}
+
+// Writes until done or the socket is full, EPOLLOUT resumes the rest
+bool EpollBackend::flushOutput(Connection &connection) {
+  while (connection.output_sent < connection.output.size()) {
+    ssize_t bytes =
+        send(connection.fd, connection.output.data() + connection.output_sent,
+             connection.output.size() - connection.output_sent, MSG_NOSIGNAL);
+    if (bytes > 0) {
+      connection.output_sent += bytes;
+      continue;
+    }
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    return bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  }
+  connection.output.clear();
+  connection.output_sent = 0;
+  return true;
+}
+
+void EpollBackend::closeConnection(Loop &loop, Connection &connection) {
+  int fd = connection.fd;
+  _handler.onClosed(connection);
+  epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  connection.fd = -1;
+  auto it = loop.connections.find(fd);
+  if (connection.suspended) {
+    loop.orphans.emplace(&connection, std::move(it->second));
+  }
+  loop.connections.erase(it); // destroys `connection` unless orphaned
+}
+
+} // namespace network
+
+#endif
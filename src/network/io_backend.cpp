@@ -0,0 +1,201 @@
+#include "../../include/network/io_backend.hpp"
+#include "../../include/network/epoll_backend.hpp"
+#include "../../include/network/uring_backend.hpp"
+#include "../../include/network/work_stealing_pool.hpp"
+#include "../../include/network/zero_copy.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <semaphore>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace network {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// Smallest free space a read goes into, the input buffer grows past it
+constexpr size_t MIN_READ = 4096;
+
+// Blocking sockets, each connection holds a pool worker for its lifetime.
+// Kept for platforms without epoll.
+class ThreadBackend : public IoBackend {
+public:
+  ThreadBackend(ConnectionHandler &handler, size_t threads)
+      : _handler(handler), _threads(threads) {}
+
+  ~ThreadBackend() override { stop(); }
+
+  void start(int listen_fd) override {
+    if (_running.exchange(true)) {
+      return;
+    }
+    _listen_fd = listen_fd;
+    _pool.init(static_cast<int>(_threads));
+    _acceptThread = std::thread(&ThreadBackend::acceptLoop, this);
+  }
+
+  void stop() override {
+    if (!_running.exchange(false)) {
+      return;
+    }
+    // Wakes accept(), the owner still closes the socket
+    shutdown(_listen_fd, SHUT_RDWR);
+    if (_acceptThread.joinable()) {
+      _acceptThread.join();
+    }
+    _pool.terminate();
+  }
+
+  size_t getThreadCount() const override { return _threads; }
+
+private:
+  void acceptLoop() {
+    while (_running) {
+      int clientSocket = accept(_listen_fd, nullptr, nullptr);
+
+      if (!_running) {
+        if (clientSocket >= 0) {
+          close(clientSocket);
+        }
+        break;
+      }
+
+      if (clientSocket < 0) {
+        if (errno == EINTR || errno == EWOULDBLOCK || errno == EAGAIN) {
+          continue;
+        }
+        std::cerr << "Failed to accept connection: " << strerror(errno)
+                  << std::endl;
+        continue;
+      }
+
+      if (!SocketOptimiser::optimiseSocket(clientSocket)) {
+        std::cerr << "Failed to optimise client socket" << std::endl;
+        close(clientSocket);
+        continue;
+      }
+
+      try {
+        _pool.submit([this, clientSocket]() { serve(clientSocket); });
+      } catch (const std::exception &e) {
+        std::cerr << "Failed to submit client task: " << e.what() << std::endl;
+        close(clientSocket);
+      }
+    }
+  }
+
+  // The connection's own worker is its loop, and simply waits out each
+  // suspension
+  struct BlockingLoop : ConnectionLoop {
+    void resume(Connection &) override { resumed.release(); }
+
+    std::binary_semaphore resumed{0};
+  };
+
+  void serve(int fd) {
+    BlockingLoop loop;
+    Connection connection(fd, &loop);
+
+    try {
+      while (_running) {
+        auto space = connection.input.prepare(MIN_READ);
+        ssize_t bytes = read(fd, space.data(), space.size());
+        if (bytes < 0 && errno == EINTR) {
+          continue;
+        }
+        if (bytes <= 0) {
+          break;
+        }
+        connection.input.commit(bytes);
+        _handler.onReadable(connection);
+        while (connection.suspended) {
+          loop.resumed.acquire();
+          connection.suspended = false;
+          _handler.onResumed(connection);
+        }
+        if (!flush(connection)) {
+          break;
+        }
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Client handler error: " << e.what() << std::endl;
+    }
+
+    _handler.onClosed(connection);
+    close(fd);
+    connection.fd = -1;
+    // The loop and connection live on this stack
+    if (connection.suspended) {
+      loop.resumed.acquire();
+    }
+  }
+
+  static bool flush(Connection &connection) {
+    while (connection.output_sent < connection.output.size()) {
+      ssize_t bytes = send(
+          connection.fd, connection.output.data() + connection.output_sent,
+          connection.output.size() - connection.output_sent, SEND_FLAGS);
+      if (bytes < 0 && errno == EINTR) {
+        continue;
+      }
+      if (bytes <= 0) {
+        return false;
+      }
+      connection.output_sent += bytes;
+    }
+    connection.output.clear();
+    connection.output_sent = 0;
+    return true;
+  }
+
+  ConnectionHandler &_handler;
+  size_t _threads;
+  int _listen_fd{-1};
+  std::atomic<bool> _running{false};
+  std::thread _acceptThread;
+  WorkStealingPool _pool;
+};
+
+} // namespace
+
+IoBackendType IoBackend::defaultType() {
+#if defined(__linux__)
+  return IoBackendType::EPOLL;
+#else
+  return IoBackendType::THREADS;
+#endif
+}
+
+std::unique_ptr<IoBackend> IoBackend::create(IoBackendType type,
+                                             ConnectionHandler &handler,
+                                             size_t threads) {
+  switch (type) {
+  case IoBackendType::THREADS:
+    return std::make_unique<ThreadBackend>(handler, threads);
+  case IoBackendType::EPOLL:
+#if defined(__linux__)
+    return std::make_unique<EpollBackend>(handler, threads);
+#else
+    break;
+#endif
+  case IoBackendType::IO_URING:
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    return std::make_unique<UringBackend>(handler, threads);
+#else
+    break;
+#endif
+  }
+  throw std::invalid_argument("I/O backend not supported on this platform");
+}
+
+} // namespace network
@@ -0,0 +1,208 @@
+#include "../../include/network/json_protocol.hpp"
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace network {
+
+namespace {
+
+using json = nlohmann::json;
+
+// Fills a JsonRequest from the parser's events. Only the top-level object's
+// fields are read, anything nested under other keys is skipped.
+class RequestReader {
+public:
+  explicit RequestReader(JsonRequest &request) : _request(request) {}
+
+  const std::string &getError() const { return _error; }
+
+  bool null() { return scalar(); }
+  bool boolean(bool) { return scalar(); }
+  bool binary(json::binary_t &) { return scalar(); }
+
+  bool number_integer(json::number_integer_t value) {
+    // Only a price may be negative
+    if (value < 0 && _depth == 1 && _field != Field::NONE &&
+        _field != Field::PRICE) {
+      return fail();
+    }
+    return number(static_cast<double>(value), static_cast<uint64_t>(value));
+  }
+
+  bool number_unsigned(json::number_unsigned_t value) {
+    return number(static_cast<double>(value), value);
+  }
+
+  bool number_float(json::number_float_t value, const json::string_t &) {
+    if (_depth == 1 && _field != Field::NONE && _field != Field::PRICE) {
+      return fail();
+    }
+    return number(value, 0);
+  }
+
+  bool string(json::string_t &value) {
+    if (_depth != 1) {
+      return _depth > 1 || notObject();
+    }
+    std::string *target = stringField();
+    if (!target) {
+      return _field == Field::NONE || fail();
+    }
+    target->assign(value);
+    return true;
+  }
+
+  bool start_object(std::size_t) { return open(); }
+  bool end_object() { return close(); }
+  bool start_array(std::size_t) { return _depth > 0 ? open() : notObject(); }
+  bool end_array() { return close(); }
+
+  bool key(json::string_t &name) {
+    if (_depth == 1) {
+      _field = fieldFor(name);
+      _key.assign(name);
+    }
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string &,
+                   const nlohmann::detail::exception &e) {
+    _error = e.what();
+    return false;
+  }
+
+private:
+  enum class Field {
+    NONE,
+    TYPE,
+    USERNAME,
+    SESSION_ID,
+    SYMBOL,
+    SIDE,
+    ORDER_ID,
+    PRICE,
+    QUANTITY
+  };
+
+  static Field fieldFor(std::string_view name) {
+    if (name == "type")
+      return Field::TYPE;
+    if (name == "username")
+      return Field::USERNAME;
+    if (name == "session_id")
+      return Field::SESSION_ID;
+    if (name == "symbol")
+      return Field::SYMBOL;
+    if (name == "side")
+      return Field::SIDE;
+    if (name == "order_id")
+      return Field::ORDER_ID;
+    if (name == "price")
+      return Field::PRICE;
+    if (name == "quantity")
+      return Field::QUANTITY;
+    return Field::NONE;
+  }
+
+  std::string *stringField() {
+    switch (_field) {
+    case Field::TYPE:
+      return &_request.type;
+    case Field::USERNAME:
+      return &_request.username;
+    case Field::SESSION_ID:
+      return &_request.session_id;
+    case Field::SYMBOL:
+      return &_request.symbol;
+    case Field::SIDE:
+      return &_request.side;
+    default:
+      return nullptr;
+    }
+  }
+
+  bool number(double value, uint64_t whole) {
+    if (_depth != 1) {
+      return _depth > 1 || notObject();
+    }
+    switch (_field) {
+    case Field::NONE:
+      return true;
+    case Field::ORDER_ID:
+      _request.order_id = whole;
+      return true;
+    case Field::PRICE:
+      _request.price = value;
+      return true;
+    case Field::QUANTITY:
+      if (whole > std::numeric_limits<uint32_t>::max()) {
+        return fail();
+      }
+      _request.quantity = static_cast<uint32_t>(whole);
+      return true;
+    default:
+      return fail(); // a string field
+    }
+  }
+
+  // A value no field of ours accepts
+  bool scalar() {
+    if (_depth != 1) {
+      return _depth > 1 || notObject();
+    }
+    return _field == Field::NONE || fail();
+  }
+
+  bool open() {
+    if (_depth == 1 && _field != Field::NONE) {
+      return fail();
+    }
+    ++_depth;
+    return true;
+  }
+
+  bool close() {
+    --_depth;
+    return true;
+  }
+
+  bool notObject() {
+    _error = "Request must be a JSON object";
+    return false;
+  }
+
+  bool fail() {
+    _error = "Invalid value for " + _key;
+    return false;
+  }
+
+  JsonRequest &_request;
+  std::string _error;
+  std::string _key;
+  Field _field{Field::NONE};
+  int _depth{0};
+};
+
+} // namespace
+
+void JsonRequest::reset() {
+  type.clear();
+  username.clear();
+  session_id.assign("default");
+  symbol.assign("STOCK");
+  side.clear();
+  order_id.reset();
+  price.reset();
+  quantity.reset();
+}
+
+void JsonProtocol::parseRequest(std::string_view line, JsonRequest &request) {
+  request.reset();
+  RequestReader reader(request);
+  if (!json::sax_parse(line.begin(), line.end(), &reader)) {
+    throw std::runtime_error(reader.getError());
+  }
+}
+
+} // namespace network
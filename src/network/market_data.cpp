@@ -1,5 +1,6 @@
 #include "../../include/network/market_data.hpp"
 #include <arpa/inet.h>
+#include <cstring>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -67,8 +68,8 @@ void MarketDataReceiver::receiveLoop() {
     if (received == sizeof(msg)) {
       msg.header.length = BinaryProtocol::ntoh16(msg.header.length);
       msg.header.seq_num = BinaryProtocol::ntoh32(msg.header.seq_num);
-      msg.best_bid = BinaryProtocol::ntohDouble(msg.best_bid);
-      msg.best_ask = BinaryProtocol::ntohDouble(msg.best_ask);
+      msg.best_bid = BinaryProtocol::ntoh64(msg.best_bid);
+      msg.best_ask = BinaryProtocol::ntoh64(msg.best_ask);
       msg.bid_size = BinaryProtocol::ntoh32(msg.bid_size);
       msg.ask_size = BinaryProtocol::ntoh32(msg.ask_size);
       msg.timestamp = BinaryProtocol::ntoh64(msg.timestamp);
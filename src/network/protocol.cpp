@@ -1,6 +1,7 @@
 #include "../../include/network/protocol.hpp"
 #include <arpa/inet.h>
 #include <cstring>
+#include <stdexcept>
 #include <unistd.h>
 
 namespace network {
@@ -47,7 +48,7 @@ BinaryProtocol::serializeJoin(const std::string &username,
 
   JoinMessage msg{};
   msg.header.type = MessageType::JOIN;
-  msg.header.length = sizeof(JoinMessage) - sizeof(MessageHeader);
+  msg.header.length = hton16(sizeof(JoinMessage) - sizeof(MessageHeader));
   // Use sequence generator in practice
   msg.header.seq_num = hton32(1);
 
@@ -59,6 +60,167 @@ BinaryProtocol::serializeJoin(const std::string &username,
   return buffer;
 }
 
+std::vector<uint8_t> BinaryProtocol::serializeNewOrder(
+    uint64_t order_id, bool is_buy, int64_t price, uint32_t quantity,
+    const std::string &symbol, const std::string &session_id) {
+
+  NewOrderMessage msg{};
+  msg.header.type = MessageType::NEW_ORDER;
+  msg.header.length = hton16(sizeof(NewOrderMessage) - sizeof(MessageHeader));
+  msg.header.seq_num = hton32(1);
+
+  msg.order_id = hton64(order_id);
+  msg.side = is_buy ? 0 : 1;
+  msg.price = hton64(price);
+  msg.quantity = hton32(quantity);
+  strncpy(msg.symbol, symbol.c_str(), sizeof(msg.symbol) - 1);
+  strncpy(msg.session_id, session_id.c_str(), sizeof(msg.session_id) - 1);
+
+  std::vector<uint8_t> buffer(sizeof(msg));
+  memcpy(buffer.data(), &msg, sizeof(msg));
+  return buffer;
+}
+
+std::vector<uint8_t> BinaryProtocol::serializeJoinAck(
+    bool success, uint32_t session_ref,
+    const std::vector<std::pair<std::string, uint32_t>> &symbol_refs) {
+
+  size_t count = success ? symbol_refs.size() : 0;
+  size_t size = sizeof(JoinAckMessage) + count * sizeof(SymbolRef);
+
+  JoinAckMessage msg{};
+  msg.header.type = MessageType::JOIN_ACK;
+  msg.header.length = hton16(size - sizeof(MessageHeader));
+  msg.header.seq_num = hton32(1);
+  msg.success = success ? 1 : 0;
+  msg.session_ref = hton32(session_ref);
+  msg.symbol_count = hton16(count);
+
+  std::vector<uint8_t> buffer(size);
+  memcpy(buffer.data(), &msg, sizeof(msg));
+  for (size_t i = 0; i < count; ++i) {
+    SymbolRef ref{};
+    strncpy(ref.symbol, symbol_refs[i].first.c_str(), sizeof(ref.symbol) - 1);
+    ref.symbol_ref = hton32(symbol_refs[i].second);
+    memcpy(buffer.data() + sizeof(msg) + i * sizeof(ref), &ref, sizeof(ref));
+  }
+  return buffer;
+}
+
+std::vector<uint8_t> BinaryProtocol::serializeNewOrderRef(
+    uint64_t order_id, bool is_buy, int64_t price, uint32_t quantity,
+    uint32_t session_ref, uint32_t symbol_ref) {
+
+  NewOrderRefMessage msg{};
+  msg.header.type = MessageType::NEW_ORDER_REF;
+  msg.header.length =
+      hton16(sizeof(NewOrderRefMessage) - sizeof(MessageHeader));
+  msg.header.seq_num = hton32(1);
+
+  msg.order_id = hton64(order_id);
+  msg.side = is_buy ? 0 : 1;
+  msg.price = hton64(price);
+  msg.quantity = hton32(quantity);
+  msg.session_ref = hton32(session_ref);
+  msg.symbol_ref = hton32(symbol_ref);
+
+  std::vector<uint8_t> buffer(sizeof(msg));
+  memcpy(buffer.data(), &msg, sizeof(msg));
+  return buffer;
+}
+
+std::vector<uint8_t> BinaryProtocol::serializeCancel(uint64_t order_id,
+                                                     uint32_t session_ref,
+                                                     uint32_t symbol_ref) {
+  CancelMessage msg{};
+  msg.header.type = MessageType::CANCEL;
+  msg.header.length = hton16(sizeof(CancelMessage) - sizeof(MessageHeader));
+  msg.header.seq_num = hton32(1);
+
+  msg.order_id = hton64(order_id);
+  msg.session_ref = hton32(session_ref);
+  msg.symbol_ref = hton32(symbol_ref);
+
+  std::vector<uint8_t> buffer(sizeof(msg));
+  memcpy(buffer.data(), &msg, sizeof(msg));
+  return buffer;
+}
+
+std::vector<uint8_t> BinaryProtocol::serializeReplace(
+    uint64_t order_id, bool is_buy, int64_t price, uint32_t quantity,
+    uint32_t session_ref, uint32_t symbol_ref) {
+
+  ReplaceMessage msg{};
+  msg.header.type = MessageType::REPLACE;
+  msg.header.length = hton16(sizeof(ReplaceMessage) - sizeof(MessageHeader));
+  msg.header.seq_num = hton32(1);
+
+  msg.order_id = hton64(order_id);
+  msg.side = is_buy ? 0 : 1;
+  msg.price = hton64(price);
+  msg.quantity = hton32(quantity);
+  msg.session_ref = hton32(session_ref);
+  msg.symbol_ref = hton32(symbol_ref);
+
+  std::vector<uint8_t> buffer(sizeof(msg));
+  memcpy(buffer.data(), &msg, sizeof(msg));
+  return buffer;
+}
+
+std::vector<uint8_t>
+BinaryProtocol::serializeNewOrderBatch(uint32_t session_ref,
+                                       std::span<const BatchOrder> orders) {
+  if (orders.size() > MAX_BATCH_ORDERS) {
+    throw std::invalid_argument("Order batch exceeds MAX_BATCH_ORDERS");
+  }
+
+  size_t size =
+      sizeof(NewOrderBatchMessage) + orders.size() * sizeof(BatchOrder);
+
+  NewOrderBatchMessage msg{};
+  msg.header.type = MessageType::NEW_ORDER_BATCH;
+  msg.header.length = hton16(size - sizeof(MessageHeader));
+  msg.header.seq_num = hton32(1);
+  msg.session_ref = hton32(session_ref);
+  msg.order_count = hton16(orders.size());
+
+  std::vector<uint8_t> buffer(size);
+  memcpy(buffer.data(), &msg, sizeof(msg));
+  uint8_t *out = buffer.data() + sizeof(msg);
+  for (const auto &order : orders) {
+    BatchOrder entry{};
+    entry.order_id = hton64(order.order_id);
+    entry.side = order.side;
+    entry.price = hton64(order.price);
+    entry.quantity = hton32(order.quantity);
+    entry.symbol_ref = hton32(order.symbol_ref);
+    memcpy(out, &entry, sizeof(entry));
+    out += sizeof(entry);
+  }
+  return buffer;
+}
+
+std::vector<uint8_t> BinaryProtocol::serializeMarketData(
+    const std::string &symbol, int64_t best_bid, int64_t best_ask,
+    uint32_t bid_size, uint32_t ask_size) {
+
+  MarketDataMessage msg{};
+  msg.header.type = MessageType::MARKET_DATA;
+  msg.header.length =
+      hton16(sizeof(MarketDataMessage) - sizeof(MessageHeader));
+  msg.header.seq_num = hton32(1);
+
+  strncpy(msg.symbol, symbol.c_str(), sizeof(msg.symbol) - 1);
+  msg.best_bid = hton64(best_bid);
+  msg.best_ask = hton64(best_ask);
+  msg.bid_size = hton32(bid_size);
+  msg.ask_size = hton32(ask_size);
+
+  std::vector<uint8_t> buffer(sizeof(msg));
+  memcpy(buffer.data(), &msg, sizeof(msg));
+  return buffer;
+}
+
 MarketDataPublisher::MarketDataPublisher(const std::string &multicast_addr,
                                          uint16_t port)
     : _multicast_addr(multicast_addr), _port(port), _socket(-1) {}
@@ -1,18 +1,25 @@
 #include "../../include/network/server.hpp"
+#include "../../include/network/frame_decoder.hpp"
+#include "../../include/network/json_protocol.hpp"
 #include "../../include/network/protocol.hpp"
-#include "../../include/network/thread_pool.hpp"
+#include "../../include/network/sharded_engine.hpp"
 #include "../../include/network/zero_copy.hpp"
 #include "../../include/orderbook/order.hpp"
 #include "../../include/orderbook/order_allocator.hpp"
 #include "../../include/orderbook/orderbook.hpp"
 #include "../../include/session/session.hpp"
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstring>
 #include <iostream>
 #include <mutex>
 #include <netinet/in.h>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <sys/socket.h>
 #include <thread>
 #include <unistd.h>
@@ -21,12 +28,13 @@
 
 namespace network {
 
-class NetworkServer::Impl {
+class NetworkServer::Impl : public ConnectionHandler {
 public:
-  Impl(uint16_t port, bool use_binary_protocol)
-      : _port(port), _running(false), _serverSocket(-1),
+  Impl(uint16_t port, bool use_binary_protocol, IoBackendType backend)
+      : _serverSocket(-1), _port(port), _running(false),
+        _shards(std::max(1u, std::thread::hardware_concurrency() / 2)),
         _use_binary_protocol(use_binary_protocol) {
-    _thread_pool.init(std::thread::hardware_concurrency());
+    _backend = IoBackend::create(backend, *this, threadsFor(backend));
     _zero_copy_handler.initBuffers(4096); // 4KB buffers
     createSession("default");
   }
@@ -67,9 +75,10 @@ public:
       throw std::runtime_error("Failed to listen on socket");
     }
 
-    _acceptThread = std::thread(&NetworkServer::Impl::acceptLoop, this);
+    _backend->start(_serverSocket);
     std::cout << "Server started on port " << _port << " with "
-              << _thread_pool.getSize() << " worker threads\n";
+              << _backend->getThreadCount() << " I/O threads and "
+              << _shards.getShardCount() << " matching shards\n";
   }
 
   void stop() {
@@ -77,23 +86,27 @@ public:
       return;
     _running = false;
 
+    // Stop the backend first, it waits for shards to hand back connections
+    _backend->stop();
     if (_serverSocket != -1) {
       close(_serverSocket);
       _serverSocket = -1;
     }
-
-    if (_acceptThread.joinable()) {
-      _acceptThread.join();
-    }
-
-    _thread_pool.terminate();
+    _shards.stop();
   }
 
   void createSession(const std::string &session_id) {
     std::lock_guard<std::mutex> lock(_sessions_mutex);
     if (_sessions.find(session_id) == _sessions.end()) {
-      _sessions[session_id] = std::make_unique<session::Session>(session_id);
-      _sessions[session_id]->createOrderBook("STOCK");
+      // Books are placed on a shard once, when they are listed
+      auto session = std::make_unique<session::Session>(
+          session_id, nullptr,
+          [this](const std::string &id, const std::string &symbol) {
+            return _shards.shardFor(id, symbol);
+          });
+      session->createOrderBook("STOCK");
+      _session_ref_by_id[session_id] = _session_refs.add(session.get());
+      _sessions[session_id] = std::move(session);
     }
   }
 
@@ -106,26 +119,39 @@ public:
     return nullptr;
   }
 
+  // Also looks up the session's ref, NO_REF past MAX_SESSIONS
+  session::Session *getSession(const std::string &session_id,
+                               uint32_t &session_ref) {
+    std::lock_guard<std::mutex> lock(_sessions_mutex);
+    auto it = _sessions.find(session_id);
+    if (it == _sessions.end()) {
+      return nullptr;
+    }
+    session_ref = _session_ref_by_id[session_id];
+    return it->second.get();
+  }
+
   void enableMarketData(const std::string &multicast_addr, uint16_t port) {
     _market_data_publisher =
         std::make_unique<MarketDataPublisher>(multicast_addr, port);
     _market_data_enabled = true;
   }
 
-  void publishMarketData(const std::string &symbol, double best_bid,
-                         double best_ask, uint32_t bid_size,
+  void publishMarketData(const std::string &symbol, int64_t best_bid,
+                         int64_t best_ask, uint32_t bid_size,
                          uint32_t ask_size) {
     if (!_market_data_enabled || !_market_data_publisher)
       return;
 
     MarketDataMessage msg{};
     msg.header.type = MessageType::MARKET_DATA;
-    msg.header.length = sizeof(MarketDataMessage) - sizeof(MessageHeader);
+    msg.header.length = BinaryProtocol::hton16(sizeof(MarketDataMessage) -
+                                               sizeof(MessageHeader));
     msg.header.seq_num = BinaryProtocol::hton32(_market_data_seq++);
 
     strncpy(msg.symbol, symbol.c_str(), sizeof(msg.symbol) - 1);
-    msg.best_bid = BinaryProtocol::htonDouble(best_bid);
-    msg.best_ask = BinaryProtocol::htonDouble(best_ask);
+    msg.best_bid = BinaryProtocol::hton64(best_bid);
+    msg.best_ask = BinaryProtocol::hton64(best_ask);
     msg.bid_size = BinaryProtocol::hton32(bid_size);
     msg.ask_size = BinaryProtocol::hton32(ask_size);
     msg.timestamp = BinaryProtocol::hton64(
@@ -134,312 +160,853 @@ public:
     _market_data_publisher->publish(msg);
   }
 
-private:
-  void acceptLoop() {
-    while (_running) {
-      sockaddr_in clientAddress{};
-      socklen_t clientLen = sizeof(clientAddress);
-      int clientSocket =
-          accept(_serverSocket, (struct sockaddr *)&clientAddress, &clientLen);
-
-      if (!_running)
-        break;
-
-      if (clientSocket < 0) {
-        if (errno == EINTR || errno == EWOULDBLOCK || errno == EAGAIN) {
-          continue;
-        }
-        std::cerr << "Failed to accept connection: " << strerror(errno)
-                  << std::endl;
-        continue;
-      }
-
-      if (!SocketOptimiser::optimiseSocket(clientSocket)) {
-        std::cerr << "Failed to optimise client socket" << std::endl;
-        close(clientSocket);
-        continue;
-      }
+  void onReadable(Connection &connection) override {
+    if (_use_binary_protocol) {
+      consumeBinaryFrames(connection);
+    } else {
+      consumeJsonMessages(connection);
+    }
+  }
 
-      try {
-        _thread_pool.async(
-            [this, clientSocket]() { handleClient(clientSocket); });
-      } catch (const std::exception &e) {
-        std::cerr << "Failed to submit client task: " << e.what() << std::endl;
-        close(clientSocket);
-      }
+  // The shard is done with the connection's orders. Replies, then carries on
+  // with whatever arrived meanwhile unless that suspends it again.
+  void onResumed(Connection &connection) override {
+    finishOrders(connection);
+    if (!connection.suspended) {
+      onReadable(connection);
     }
   }
 
-  void handleClient(int clientSocket) {
-    ZeroCopyHandler client_handler;
-    client_handler.initBuffers(4096);
+  void onClosed(Connection &connection) override {
+    std::lock_guard<std::mutex> lock(_sessions_mutex);
+    for (auto &[_, session] : _sessions) {
+      session->removeUserBySocket(connection.fd);
+    }
+  }
 
-    try {
-      while (_running) {
-        if (_use_binary_protocol) {
-          handleBinaryMessage(clientSocket, client_handler);
-        } else {
-          handleJsonMessage(clientSocket, client_handler);
-        }
-      }
-    } catch (const std::exception &e) {
-      std::cerr << "Client handler error: " << e.what() << std::endl;
+private:
+  enum class OrderAction : uint8_t { NEW, REPLACE, CANCEL };
+
+  // An order on its way to the book, `index` is its place in a batch. A
+  // CANCEL uses only the id.
+  struct PendingOrder {
+    size_t index;
+    OrderAction action;
+    uint64_t order_id;
+    orderbook::Side side;
+    orderbook::Price price;
+    uint32_t quantity;
+    orderbook::MatchResult result;
+  };
+
+  // A session this connection joined and the user it joined as. Orders
+  // rest under the user's owner id, and only that user can cancel or
+  // replace them, from this or any later connection.
+  struct JoinedSession {
+    session::Session *session;
+    std::shared_ptr<session::User> user;
+  };
+
+  enum class Reply : uint8_t { JSON, BINARY, BATCH };
+
+  // Orders handed to a shard while the connection is suspended. The shard
+  // fills in each result, then resumes the connection to settle and reply.
+  // A batch goes one run of orders on the same book at a time.
+  struct InFlight {
+    InFlight() {
+      orders.reserve(MAX_BATCH_ORDERS);
+      entries.reserve(MAX_BATCH_ORDERS);
     }
 
-    {
-      std::lock_guard<std::mutex> lock(_sessions_mutex);
-      for (auto &[_, session] : _sessions) {
-        session->removeUserBySocket(clientSocket);
+    Reply reply{Reply::JSON};
+    session::User *user{nullptr};
+    uint32_t owner{0};
+    orderbook::OrderBook *book{nullptr};
+    std::string symbol;
+    std::vector<PendingOrder> orders;
+    std::vector<orderbook::Fill> fills;
+
+    // The batch's entries are copied out, the frame is gone once it suspends
+    session::Session *session{nullptr};
+    std::vector<BatchOrder> entries;
+    std::array<BatchAck, MAX_BATCH_ORDERS> acks;
+    size_t next_run{0};
+  };
+
+  // Kept in Connection::state, so orders find their user without a lookup
+  struct ClientState {
+    std::vector<JoinedSession> joined;
+    InFlight in_flight;
+  };
+
+  static void recordJoin(Connection &connection, session::Session &session,
+                         const std::string &username) {
+    if (!connection.state) {
+      connection.state = std::make_shared<ClientState>();
+    }
+    auto &joined = static_cast<ClientState *>(connection.state.get())->joined;
+    JoinedSession entry{&session, session.getUser(username)};
+    for (auto &existing : joined) {
+      if (existing.session == &session) {
+        existing = std::move(entry); // the socket's latest join wins
+        return;
       }
     }
-    close(clientSocket);
+    joined.push_back(std::move(entry));
   }
 
-  void handleJsonMessage(int clientSocket, ZeroCopyHandler &handler) {
-    std::array<char, 4096> buffer;
-    ssize_t bytesRead = read(clientSocket, buffer.data(), buffer.size() - 1);
-
-    if (bytesRead <= 0)
-      return;
-
-    std::string message(buffer.data(), bytesRead);
-    try {
-      nlohmann::json j = nlohmann::json::parse(message);
-
-      std::string type = j["type"];
-      if (type == "join") {
-        handleJsonJoin(clientSocket, j);
-      } else if (type == "new_order") {
-        handleJsonOrder(clientSocket, j);
+  // Null unless this connection joined `session`
+  static const JoinedSession *joinedAs(const Connection &connection,
+                                       const session::Session &session) {
+    const auto *state =
+        static_cast<const ClientState *>(connection.state.get());
+    if (!state) {
+      return nullptr;
+    }
+    for (const auto &entry : state->joined) {
+      if (entry.session == &session) {
+        return &entry;
       }
-    } catch (const std::exception &e) {
-      std::string errorResponse = "{\"status\":\"error\",\"message\":\"" +
-                                  std::string(e.what()) + "\"}";
-      send(clientSocket, errorResponse.c_str(), errorResponse.length(), 0);
     }
+    return nullptr;
   }
 
-  void handleBinaryMessage(int clientSocket, ZeroCopyHandler &handler) {
-    MessageHeader header;
-    ssize_t bytes_read =
-        recv(clientSocket, &header, sizeof(header), MSG_WAITALL);
+  // Only for a connection that has joined a session
+  static InFlight &inFlight(Connection &connection) {
+    return static_cast<ClientState *>(connection.state.get())->in_flight;
+  }
 
-    if (bytes_read <= 0)
-      return;
+  // Only "buy" and "sell", or 0 and 1 on the wire, name a side
+  static std::optional<orderbook::Side> parseSide(std::string_view side) {
+    if (side == "buy") {
+      return orderbook::Side::BUY;
+    }
+    if (side == "sell") {
+      return orderbook::Side::SELL;
+    }
+    return std::nullopt;
+  }
 
-    header.length = BinaryProtocol::ntoh16(header.length);
-    header.seq_num = BinaryProtocol::ntoh32(header.seq_num);
+  static std::optional<orderbook::Side> parseSide(uint8_t side) {
+    if (side > 1) {
+      return std::nullopt;
+    }
+    return side == 0 ? orderbook::Side::BUY : orderbook::Side::SELL;
+  }
 
-    std::vector<uint8_t> body(header.length);
-    bytes_read = recv(clientSocket, body.data(), header.length, MSG_WAITALL);
+  // Event loops are cheap, a thread per connection is not
+  static size_t threadsFor(IoBackendType backend) {
+    size_t cores = std::thread::hardware_concurrency();
+    if (backend == IoBackendType::THREADS) {
+      return std::max<size_t>(4, cores);
+    }
+    return std::max<size_t>(2, cores / 4);
+  }
 
-    if (bytes_read <= 0)
-      return;
+  // Handles every complete line in the input, each one request. A request
+  // that fails gets an error reply and the rest carry on. An order stops
+  // it until the connection is resumed.
+  void consumeJsonMessages(Connection &connection) {
+    LineDecoder lines(connection.input);
+    JsonRequest request;
+    while (!connection.suspended) {
+      auto line = lines.next();
+      if (!line) {
+        break;
+      }
+      if (line->empty()) {
+        continue;
+      }
+      try {
+        JsonProtocol::parseRequest(*line, request);
+        if (request.type.empty()) {
+          throw std::runtime_error("Missing field: type");
+        }
+        if (request.type == "join") {
+          handleJsonJoin(connection, request);
+        } else if (request.type == "new_order") {
+          handleJsonOrder(connection, request, OrderAction::NEW);
+        } else if (request.type == "replace") {
+          handleJsonOrder(connection, request, OrderAction::REPLACE);
+        } else if (request.type == "cancel") {
+          handleJsonOrder(connection, request, OrderAction::CANCEL);
+        }
+      } catch (const std::exception &e) {
+        sendJsonError(connection, e.what());
+      }
+    }
+    if (!connection.suspended &&
+        lines.getPending() > JsonProtocol::MAX_LINE) {
+      throw std::runtime_error("JSON request exceeds the line limit");
+    }
+  }
 
-    switch (header.type) {
-    case MessageType::JOIN:
-      handleBinaryJoin(clientSocket, body);
-      break;
-    case MessageType::NEW_ORDER:
-      handleBinaryOrder(clientSocket, body);
-      break;
-    default:
-      std::cerr << "Unknown message type: " << static_cast<int>(header.type)
-                << std::endl;
-      break;
+  // Dispatches every complete frame in the input, in place. A trailing
+  // partial frame stays in the buffer for the next read, and an order stops
+  // it until the connection is resumed.
+  void consumeBinaryFrames(Connection &connection) {
+    FrameDecoder frames(connection.input);
+    while (!connection.suspended) {
+      auto frame = frames.next();
+      if (!frame) {
+        break;
+      }
+      switch (frame->header.type) {
+      case MessageType::JOIN:
+        handleBinaryJoin(connection, frame->bytes);
+        break;
+      case MessageType::NEW_ORDER:
+        handleBinaryOrder(connection, frame->bytes);
+        break;
+      case MessageType::NEW_ORDER_REF:
+        handleBinaryOrderRef(connection, frame->bytes);
+        break;
+      case MessageType::NEW_ORDER_BATCH:
+        handleBinaryOrderBatch(connection, frame->bytes);
+        break;
+      case MessageType::REPLACE:
+        handleBinaryReplace(connection, frame->bytes);
+        break;
+      case MessageType::CANCEL:
+        handleBinaryCancel(connection, frame->bytes);
+        break;
+      default:
+        std::cerr << "Unknown message type: "
+                  << static_cast<int>(frame->header.type) << std::endl;
+        break;
+      }
     }
   }
 
-  void handleJsonJoin(int clientSocket, const nlohmann::json &j) {
-    std::string username = j["username"];
-    std::string session_id = j.value("session_id", "default");
+  void handleJsonJoin(Connection &connection, const JsonRequest &request) {
+    const std::string &username = request.username;
+    const std::string &session_id = request.session_id;
+    if (username.empty()) {
+      throw std::runtime_error("Missing field: username");
+    }
 
     auto *session = getSession(session_id);
     if (!session) {
       throw std::runtime_error("Session not found");
     }
 
-    if (session->addUser(username, clientSocket)) {
+    if (session->addUser(username, connection.fd)) {
+      recordJoin(connection, *session, username);
       nlohmann::json response = {{"status", "success"},
                                  {"message", "Joined session"},
                                  {"session_id", session_id},
                                  {"username", username}};
-      sendResponse(clientSocket, response.dump());
+      sendResponse(connection, response.dump());
     } else {
       throw std::runtime_error("Username already taken");
     }
   }
 
-  void handleBinaryJoin(int clientSocket, const std::vector<uint8_t> &body) {
-    if (body.size() < sizeof(JoinMessage) - sizeof(MessageHeader)) {
+  void handleBinaryJoin(Connection &connection,
+                        std::span<const uint8_t> frame) {
+    if (frame.size() < sizeof(JoinMessage)) {
       return;
     }
 
-    const auto *join_data = reinterpret_cast<const JoinMessage *>(body.data());
-    std::string username(join_data->username);
-    std::string session_id(join_data->session_id);
+    const auto *join_data = reinterpret_cast<const JoinMessage *>(frame.data());
+    std::string username = fixedString(join_data->username);
+    std::string session_id = fixedString(join_data->session_id);
 
-    auto *session = getSession(session_id);
-    if (!session) {
+    // The ack hands back the refs NEW_ORDER_REF addresses the session by
+    uint32_t session_ref = SessionRefs::NO_REF;
+    auto *session = getSession(session_id, session_ref);
+    if (!session || !session->addUser(username, connection.fd)) {
+      sendBinaryResponse(connection,
+                         BinaryProtocol::serializeJoinAck(false, 0, {}));
       return;
     }
+    recordJoin(connection, *session, username);
+    sendBinaryResponse(connection,
+                       BinaryProtocol::serializeJoinAck(
+                           true, session_ref, session->getSymbolRefs()));
+  }
 
-    if (session->addUser(username, clientSocket)) {
-      std::vector<uint8_t> response =
-          BinaryProtocol::serializeJoin(username, session_id);
-      send(clientSocket, response.data(), response.size(), 0);
+  // new_order, replace and cancel. A cancel needs only the order id.
+  void handleJsonOrder(Connection &connection, const JsonRequest &request,
+                       OrderAction action) {
+    bool cancel = action == OrderAction::CANCEL;
+    if (!request.order_id) {
+      throw std::runtime_error("Missing field: order_id");
+    }
+    if (!cancel && (!request.price || !request.quantity)) {
+      throw std::runtime_error("Missing field: price or quantity");
     }
-  }
 
-  void handleJsonOrder(int clientSocket, const nlohmann::json &j) {
-    std::string session_id = j.value("session_id", "default");
+    const std::string &session_id = request.session_id;
     auto *session = getSession(session_id);
     if (!session) {
       throw std::runtime_error("Session not found");
     }
 
-    auto user = session->getUserBySocket(clientSocket);
-    if (!user) {
+    const auto *client = joinedAs(connection, *session);
+    if (!client) {
       throw std::runtime_error("User not found");
     }
+    session::User *user = client->user.get();
 
-    std::string symbol = j.value("symbol", "STOCK");
+    const std::string &symbol = request.symbol;
     auto *orderbook = session->getOrderBook(symbol);
     if (!orderbook) {
       throw std::runtime_error("Symbol not found");
     }
 
-    orderbook::Side side =
-        j["side"] == "buy" ? orderbook::Side::BUY : orderbook::Side::SELL;
-    uint64_t order_id = j["order_id"];
-    double price = j["price"];
-    uint32_t quantity = j["quantity"];
+    // JSON carries display prices, the book only ever sees ticks
+    const auto &scale = orderbook->getPriceScale();
+    auto parsed_side = parseSide(request.side);
+    if (!cancel && !parsed_side) {
+      throw std::runtime_error("Invalid side");
+    }
+    orderbook::Side side = parsed_side.value_or(orderbook::Side::BUY);
+    uint64_t order_id = *request.order_id;
+    orderbook::Price price = cancel ? 0 : scale.toTicks(*request.price);
+    uint32_t quantity = cancel ? 0 : *request.quantity;
+    if (!cancel && quantity == 0) {
+      throw std::runtime_error("Invalid quantity");
+    }
 
-    if (side == orderbook::Side::BUY &&
-        !user->canAffordTrade(price, quantity)) {
+    if (!cancel && side == orderbook::Side::BUY &&
+        !user->canAffordTrade(scale.toDouble(price), quantity)) {
       throw std::runtime_error("Insufficient funds");
     }
 
-    if (side == orderbook::Side::SELL && user->getPosition(symbol) < quantity) {
+    if (!cancel && side == orderbook::Side::SELL &&
+        user->getPosition(symbol) < quantity) {
       throw std::runtime_error("Insufficient position");
     }
 
-    auto *order =
-        orderbook::OrderAllocator::create(order_id, side, price, quantity);
+    submitOrder(connection, *client, Reply::JSON, symbol, *orderbook,
+                _shards.shardFor(session_id, symbol),
+                {0, action, order_id, side, price, quantity, {}});
+  }
 
-    auto match_result = orderbook->matchOrder(*order);
+  void handleBinaryOrder(Connection &connection,
+                         std::span<const uint8_t> frame) {
+    if (frame.size() < sizeof(NewOrderMessage)) {
+      return;
+    }
 
-    if (match_result) {
-      if (side == orderbook::Side::BUY) {
-        user->updateBalance(-price * quantity);
-        user->addPosition(symbol, quantity);
-      } else {
-        user->updateBalance(price * quantity);
-        user->removePosition(symbol, quantity);
-      }
+    const auto *order_data =
+        reinterpret_cast<const NewOrderMessage *>(frame.data());
 
-      nlohmann::json response = {{"status", "success"},
-                                 {"message", "Order matched"},
-                                 {"order_id", order_id}};
-      sendResponse(clientSocket, response.dump());
-      orderbook::OrderAllocator::destroy(order);
-    } else {
-      if (orderbook->addOrder(*order)) {
-        nlohmann::json response = {{"status", "success"},
-                                   {"message", "Order added to book"},
-                                   {"order_id", order_id}};
-        sendResponse(clientSocket, response.dump());
-      } else {
-        orderbook::OrderAllocator::destroy(order);
-        throw std::runtime_error("Failed to add order");
-      }
+    uint64_t order_id = BinaryProtocol::ntoh64(order_data->order_id);
+    orderbook::Price price = BinaryProtocol::ntoh64(order_data->price);
+    uint32_t quantity = BinaryProtocol::ntoh32(order_data->quantity);
+
+    std::string session_id = fixedString(order_data->session_id);
+    std::string symbol = fixedString(order_data->symbol);
+
+    auto *session = getSession(session_id);
+    if (!session) {
+      sendBinaryError(connection, "Session not found");
+      return;
     }
+
+    auto *orderbook = session->getOrderBook(symbol);
+    if (!orderbook) {
+      sendBinaryError(connection, "Symbol not found");
+      return;
+    }
+
+    placeBinaryOrder(connection, *session, symbol, *orderbook,
+                     _shards.shardFor(session_id, symbol), OrderAction::NEW,
+                     order_id, order_data->side, price, quantity);
   }
 
-  void handleBinaryOrder(int clientSocket, const std::vector<uint8_t> &body) {
-    if (body.size() < sizeof(NewOrderMessage) - sizeof(MessageHeader)) {
+  // NEW_ORDER by the refs from JOIN_ACK
+  void handleBinaryOrderRef(Connection &connection,
+                            std::span<const uint8_t> frame) {
+    if (frame.size() < sizeof(NewOrderRefMessage)) {
       return;
     }
 
     const auto *order_data =
-        reinterpret_cast<const NewOrderMessage *>(body.data());
+        reinterpret_cast<const NewOrderRefMessage *>(frame.data());
+    session::Session *session;
+    const auto *listing = resolveRefs(connection, order_data->session_ref,
+                                      order_data->symbol_ref, session);
+    if (!listing) {
+      return;
+    }
 
-    uint64_t order_id = BinaryProtocol::ntoh64(order_data->order_id);
-    double price = BinaryProtocol::ntohDouble(order_data->price);
-    uint32_t quantity = BinaryProtocol::ntoh32(order_data->quantity);
+    placeBinaryOrder(connection, *session, listing->symbol, *listing->book,
+                     listing->shard, OrderAction::NEW,
+                     BinaryProtocol::ntoh64(order_data->order_id),
+                     order_data->side,
+                     BinaryProtocol::ntoh64(order_data->price),
+                     BinaryProtocol::ntoh32(order_data->quantity));
+  }
 
-    std::string session_id(order_data->session_id);
-    std::string symbol(order_data->symbol);
+  void handleBinaryReplace(Connection &connection,
+                           std::span<const uint8_t> frame) {
+    if (frame.size() < sizeof(ReplaceMessage)) {
+      return;
+    }
 
-    auto *session = getSession(session_id);
+    const auto *replace =
+        reinterpret_cast<const ReplaceMessage *>(frame.data());
+    session::Session *session;
+    const auto *listing = resolveRefs(connection, replace->session_ref,
+                                      replace->symbol_ref, session);
+    if (!listing) {
+      return;
+    }
+
+    placeBinaryOrder(connection, *session, listing->symbol, *listing->book,
+                     listing->shard, OrderAction::REPLACE,
+                     BinaryProtocol::ntoh64(replace->order_id), replace->side,
+                     BinaryProtocol::ntoh64(replace->price),
+                     BinaryProtocol::ntoh32(replace->quantity));
+  }
+
+  void handleBinaryCancel(Connection &connection,
+                          std::span<const uint8_t> frame) {
+    if (frame.size() < sizeof(CancelMessage)) {
+      return;
+    }
+
+    const auto *cancel = reinterpret_cast<const CancelMessage *>(frame.data());
+    session::Session *session;
+    const auto *listing = resolveRefs(connection, cancel->session_ref,
+                                      cancel->symbol_ref, session);
+    if (!listing) {
+      return;
+    }
+
+    placeBinaryOrder(connection, *session, listing->symbol, *listing->book,
+                     listing->shard, OrderAction::CANCEL,
+                     BinaryProtocol::ntoh64(cancel->order_id), 0, 0, 0);
+  }
+
+  // Resolves the refs from JOIN_ACK, both in network byte order, through
+  // lock-free tables. The listing already knows its book's shard. Replies
+  // with an error and returns null if either is unknown.
+  const session::Session::Listing *resolveRefs(Connection &connection,
+                                               uint32_t session_ref,
+                                               uint32_t symbol_ref,
+                                               session::Session *&session) {
+    session = _session_refs.find(BinaryProtocol::ntoh32(session_ref));
     if (!session) {
-      sendBinaryError(clientSocket, "Session not found");
+      sendBinaryError(connection, "Session not found");
+      return nullptr;
+    }
+
+    const auto *listing =
+        session->getListing(BinaryProtocol::ntoh32(symbol_ref));
+    if (!listing) {
+      sendBinaryError(connection, "Symbol not found");
+    }
+    return listing;
+  }
+
+  // Each run of consecutive orders on one book is checked against the user
+  // as a whole and matched in a single shard task, and the whole batch is
+  // answered with one ORDER_ACK_BATCH frame.
+  void handleBinaryOrderBatch(Connection &connection,
+                              std::span<const uint8_t> frame) {
+    if (frame.size() < sizeof(NewOrderBatchMessage)) {
       return;
     }
 
-    auto user = session->getUserBySocket(clientSocket);
-    if (!user) {
-      sendBinaryError(clientSocket, "User not found");
+    const auto *batch =
+        reinterpret_cast<const NewOrderBatchMessage *>(frame.data());
+    size_t count = BinaryProtocol::ntoh16(batch->order_count);
+    size_t expected =
+        sizeof(NewOrderBatchMessage) + count * sizeof(BatchOrder);
+    if (count > MAX_BATCH_ORDERS || frame.size() < expected) {
+      sendBinaryError(connection, "Malformed order batch");
+      return;
+    }
+    std::span<const BatchOrder> entries(
+        reinterpret_cast<const BatchOrder *>(frame.data() +
+                                             sizeof(NewOrderBatchMessage)),
+        count);
+
+    auto *session =
+        _session_refs.find(BinaryProtocol::ntoh32(batch->session_ref));
+    const auto *client = session ? joinedAs(connection, *session) : nullptr;
+    if (!client) {
+      std::array<BatchAck, MAX_BATCH_ORDERS> acks;
+      for (size_t i = 0; i < count; ++i) {
+        acks[i] = BatchAck{entries[i].order_id,
+                           session ? BatchAckStatus::USER_NOT_FOUND
+                                   : BatchAckStatus::SESSION_NOT_FOUND,
+                           0, 0};
+      }
+      sendOrderAckBatch(connection, {acks.data(), count});
       return;
     }
 
-    auto *orderbook = session->getOrderBook(symbol);
-    if (!orderbook) {
-      sendBinaryError(clientSocket, "Symbol not found");
+    InFlight &in_flight = inFlight(connection);
+    in_flight.reply = Reply::BATCH;
+    in_flight.user = client->user.get();
+    in_flight.owner = client->user->getOwnerId();
+    in_flight.session = session;
+    in_flight.entries.assign(entries.begin(), entries.end());
+    for (size_t i = 0; i < count; ++i) {
+      in_flight.acks[i] =
+          BatchAck{entries[i].order_id, BatchAckStatus::REJECTED, 0, 0};
+    }
+    in_flight.next_run = 0;
+    continueBatch(connection);
+  }
+
+  // Posts the batch's next run that has anything to match, or sends the
+  // acks once every run is done
+  void continueBatch(Connection &connection) {
+    InFlight &in_flight = inFlight(connection);
+    const auto &entries = in_flight.entries;
+    auto &acks = in_flight.acks;
+    size_t count = entries.size();
+
+    while (in_flight.next_run < count) {
+      size_t begin = in_flight.next_run;
+      uint32_t symbol_ref = entries[begin].symbol_ref;
+      size_t end = begin + 1;
+      while (end < count && entries[end].symbol_ref == symbol_ref) {
+        ++end;
+      }
+      in_flight.next_run = end;
+
+      const auto *listing =
+          in_flight.session->getListing(BinaryProtocol::ntoh32(symbol_ref));
+      if (!listing) {
+        for (size_t i = begin; i < end; ++i) {
+          acks[i].status = BatchAckStatus::SYMBOL_NOT_FOUND;
+        }
+        continue;
+      }
+
+      // Later orders in the run are checked against what earlier ones
+      // would spend or sell, before any of them fill
+      const auto &scale = listing->book->getPriceScale();
+      double balance = in_flight.user->getBalance();
+      uint32_t position = in_flight.user->getPosition(listing->symbol);
+      in_flight.orders.clear();
+      for (size_t i = begin; i < end; ++i) {
+        auto parsed_side = parseSide(entries[i].side);
+        if (!parsed_side) {
+          acks[i].status = BatchAckStatus::INVALID_SIDE;
+          continue;
+        }
+        orderbook::Side side = *parsed_side;
+        orderbook::Price price = BinaryProtocol::ntoh64(entries[i].price);
+        uint32_t quantity = BinaryProtocol::ntoh32(entries[i].quantity);
+        if (quantity == 0) {
+          acks[i].status = BatchAckStatus::INVALID_QUANTITY;
+          continue;
+        }
+        if (side == orderbook::Side::BUY) {
+          double cost = scale.toDouble(price) * quantity;
+          if (balance < cost) {
+            acks[i].status = BatchAckStatus::INSUFFICIENT_FUNDS;
+            continue;
+          }
+          balance -= cost;
+        } else {
+          if (position < quantity) {
+            acks[i].status = BatchAckStatus::INSUFFICIENT_POSITION;
+            continue;
+          }
+          position -= quantity;
+        }
+        in_flight.orders.push_back(PendingOrder{
+            i, OrderAction::NEW, BinaryProtocol::ntoh64(entries[i].order_id),
+            side, price, quantity, {}});
+      }
+      if (in_flight.orders.empty()) {
+        continue;
+      }
+
+      in_flight.book = listing->book;
+      in_flight.symbol = listing->symbol;
+      if (postOrders(connection, listing->shard)) {
+        return; // finishOrders picks the batch up again
+      }
+    }
+
+    sendOrderAckBatch(connection, {acks.data(), count});
+  }
+
+  // Checks shared by the single-order binary messages, then executes and
+  // acks. Orders and replaces are checked against the user, cancels are not.
+  void placeBinaryOrder(Connection &connection,
+                        const session::Session &session,
+                        const std::string &symbol, orderbook::OrderBook &book,
+                        size_t shard, OrderAction action, uint64_t order_id,
+                        uint8_t side_byte, orderbook::Price price,
+                        uint32_t quantity) {
+    const auto *client = joinedAs(connection, session);
+    if (!client) {
+      sendBinaryError(connection, "User not found");
       return;
     }
+    session::User *user = client->user.get();
 
-    orderbook::Side side =
-        order_data->side == 0 ? orderbook::Side::BUY : orderbook::Side::SELL;
+    bool cancel = action == OrderAction::CANCEL;
+    auto parsed_side = parseSide(side_byte);
+    if (!cancel && !parsed_side) {
+      sendBinaryError(connection, "Invalid side");
+      return;
+    }
+    orderbook::Side side = parsed_side.value_or(orderbook::Side::BUY);
+    if (!cancel && quantity == 0) {
+      sendBinaryError(connection, "Invalid quantity");
+      return;
+    }
+    const auto &scale = book.getPriceScale();
 
-    if (side == orderbook::Side::BUY &&
-        !user->canAffordTrade(price, quantity)) {
-      sendBinaryError(clientSocket, "Insufficient funds");
+    if (!cancel && side == orderbook::Side::BUY &&
+        !user->canAffordTrade(scale.toDouble(price), quantity)) {
+      sendBinaryError(connection, "Insufficient funds");
       return;
     }
 
-    if (side == orderbook::Side::SELL && user->getPosition(symbol) < quantity) {
-      sendBinaryError(clientSocket, "Insufficient position");
+    if (!cancel && side == orderbook::Side::SELL &&
+        user->getPosition(symbol) < quantity) {
+      sendBinaryError(connection, "Insufficient position");
       return;
     }
 
-    auto *order =
-        orderbook::OrderAllocator::create(order_id, side, price, quantity);
+    submitOrder(connection, *client, Reply::BINARY, symbol, book, shard,
+                {0, action, order_id, side, price, quantity, {}});
+  }
+
+  // Starts one order, replace or cancel on the shard that owns the book.
+  // Its reply goes out once the shard is done.
+  void submitOrder(Connection &connection, const JoinedSession &client,
+                   Reply reply, const std::string &symbol,
+                   orderbook::OrderBook &book, size_t shard,
+                   const PendingOrder &order) {
+    InFlight &in_flight = inFlight(connection);
+    in_flight.reply = reply;
+    in_flight.user = client.user.get();
+    in_flight.owner = client.user->getOwnerId();
+    in_flight.book = &book;
+    in_flight.symbol = symbol;
+    in_flight.orders.assign(1, order);
+    if (!postOrders(connection, shard)) {
+      finishOrders(connection); // replies that it failed
+    }
+  }
+
+  // Suspends the connection and applies its in-flight orders in sequence
+  // to their book, in a single task on the book's shard. Orders and
+  // replaces sweep as many levels as they cross and rest the remainder. The
+  // task only carries two pointers, small enough for std::function to hold
+  // inline. Returns false, leaving every result unaccepted, once the shards
+  // have stopped.
+  bool postOrders(Connection &connection, size_t shard) {
+    Connection *suspended = &connection;
+    InFlight *in_flight = &inFlight(connection);
+    in_flight->fills.clear();
+
+    connection.suspended = true;
+    bool posted = _shards.post(shard, [suspended, in_flight]() {
+      for (auto &order : in_flight->orders) {
+        order.result = applyToBook(*in_flight->book, order, in_flight->owner,
+                                   in_flight->fills);
+      }
+      suspended->loop->resume(*suspended);
+    });
+    if (!posted) {
+      connection.suspended = false;
+    }
+    return posted;
+  }
 
-    auto match_result = orderbook->matchOrder(*order);
+  // Back on the connection's thread. The taker's side of each fill is
+  // settled here at the fill price, so a user is only ever updated from the
+  // connection's own thread. A batch carries on with its next run.
+  void finishOrders(Connection &connection) {
+    InFlight &in_flight = inFlight(connection);
+
+    // Fills are in order, result.fill_count of them per order
+    session::User &user = *in_flight.user;
+    const auto &scale = in_flight.book->getPriceScale();
+    const orderbook::Fill *fill = in_flight.fills.data();
+    for (const auto &order : in_flight.orders) {
+      for (size_t i = 0; i < order.result.fill_count; ++i, ++fill) {
+        double notional = scale.toDouble(fill->price) * fill->quantity;
+        if (order.side == orderbook::Side::BUY) {
+          user.updateBalance(-notional);
+          user.addPosition(in_flight.symbol, fill->quantity);
+        } else {
+          user.updateBalance(notional);
+          user.removePosition(in_flight.symbol, fill->quantity);
+        }
+      }
+    }
 
-    if (match_result) {
-      if (side == orderbook::Side::BUY) {
-        user->updateBalance(-price * quantity);
-        user->addPosition(symbol, quantity);
+    const PendingOrder &order = in_flight.orders.front();
+    const auto &result = order.result;
+    switch (in_flight.reply) {
+    case Reply::JSON:
+      if (result.accepted) {
+        nlohmann::json response = {{"status", "success"},
+                                   {"message", describeResult(order.action,
+                                                              result)},
+                                   {"order_id", order.order_id},
+                                   {"filled_quantity", result.filled_quantity}};
+        sendResponse(connection, response.dump());
       } else {
-        user->updateBalance(price * quantity);
-        user->removePosition(symbol, quantity);
+        sendJsonError(connection, describeFailure(order.action));
       }
+      break;
+    case Reply::BINARY:
+      if (result.accepted) {
+        sendBinaryOrderResponse(connection, order.order_id, true,
+                                describeResult(order.action, result));
+      } else {
+        sendBinaryError(connection, describeFailure(order.action));
+      }
+      break;
+    case Reply::BATCH:
+      for (const auto &done : in_flight.orders) {
+        auto &ack = in_flight.acks[done.index];
+        if (done.result.accepted) {
+          ack.status = BatchAckStatus::ACCEPTED;
+          ack.filled_quantity =
+              BinaryProtocol::hton32(done.result.filled_quantity);
+          ack.rested = done.result.rested ? 1 : 0;
+        }
+      }
+      continueBatch(connection);
+      break;
+    }
+  }
+
+  // Runs on the book's shard, appending any fills to `out`. Cancels and
+  // replaces only reach orders resting under `owner`.
+  static orderbook::MatchResult applyToBook(orderbook::OrderBook &book,
+                                            const PendingOrder &order,
+                                            uint32_t owner,
+                                            std::vector<orderbook::Fill> &out) {
+    switch (order.action) {
+    case OrderAction::CANCEL: {
+      orderbook::MatchResult result;
+      result.accepted = book.cancelOrder(order.order_id, owner);
+      return result;
+    }
+    case OrderAction::REPLACE:
+      return replaceInBook(book, order, owner, out);
+    default:
+      return sweepBook(book, order.order_id, order.side, order.price,
+                       order.quantity, owner, out);
+    }
+  }
+
+  // Amends the order inside the book in one step. If the new price crosses
+  // more resting orders than one fill buffer holds, the remainder carries on
+  // sweeping like a new order.
+  static orderbook::MatchResult
+  replaceInBook(orderbook::OrderBook &book, const PendingOrder &order,
+                uint32_t owner, std::vector<orderbook::Fill> &out) {
+    std::array<orderbook::Fill, MAX_FILLS_PER_SWEEP> fills;
+    auto result = book.replaceOrder(order.order_id, order.side, order.price,
+                                    order.quantity, fills, owner);
+    out.insert(out.end(), fills.begin(), fills.begin() + result.fill_count);
+    if (!result.accepted || result.rested || result.remaining_quantity == 0) {
+      return result;
+    }
 
-      sendBinaryOrderResponse(clientSocket, order_id, true, "Order matched");
+    auto rest = sweepBook(book, order.order_id, order.side, order.price,
+                          result.remaining_quantity, owner, out);
+    result.rested = rest.rested;
+    result.fill_count += rest.fill_count;
+    result.filled_quantity += rest.filled_quantity;
+    result.remaining_quantity = rest.remaining_quantity;
+    return result;
+  }
+
+  // Runs on the book's shard. Sweeps in MAX_FILLS_PER_SWEEP chunks, copying
+  // each chunk of fills out for settlement.
+  static orderbook::MatchResult
+  sweepBook(orderbook::OrderBook &book, uint64_t order_id,
+            orderbook::Side side, orderbook::Price price, uint32_t quantity,
+            uint32_t owner, std::vector<orderbook::Fill> &out) {
+    std::array<orderbook::Fill, MAX_FILLS_PER_SWEEP> fills;
+    orderbook::MatchResult result;
+
+    uint32_t remaining = quantity;
+    while (true) {
+      auto *order = orderbook::OrderAllocator::create(order_id, side, price,
+                                                      remaining, owner);
+      auto sweep = book.addOrder(*order, fills);
       orderbook::OrderAllocator::destroy(order);
-    } else {
-      if (orderbook->addOrder(*order)) {
-        sendBinaryOrderResponse(clientSocket, order_id, true,
-                                "Order added to book");
-      } else {
-        orderbook::OrderAllocator::destroy(order);
-        sendBinaryError(clientSocket, "Failed to add order");
+      if (!sweep.accepted) {
+        return result;
       }
+
+      out.insert(out.end(), fills.begin(), fills.begin() + sweep.fill_count);
+      result.accepted = true;
+      result.rested = sweep.rested;
+      result.fill_count += sweep.fill_count;
+      result.filled_quantity += sweep.filled_quantity;
+      result.remaining_quantity = sweep.remaining_quantity;
+
+      // Only a full fill buffer leaves a remainder that is neither filled
+      // nor rested, so carry on sweeping with what is left
+      if (sweep.rested || sweep.remaining_quantity == 0) {
+        return result;
+      }
+      remaining = sweep.remaining_quantity;
     }
   }
 
-  void sendResponse(int clientSocket, const std::string &response) {
-    send(clientSocket, response.c_str(), response.length(), 0);
+  static const char *describeResult(OrderAction action,
+                                    const orderbook::MatchResult &result) {
+    if (action == OrderAction::CANCEL) {
+      return "Order cancelled";
+    }
+    if (action == OrderAction::REPLACE) {
+      if (result.filled_quantity == 0) {
+        return "Order replaced";
+      }
+      return result.rested ? "Order replaced, partially matched"
+                           : "Order replaced and matched";
+    }
+    if (result.filled_quantity == 0) {
+      return "Order added to book";
+    }
+    return result.rested ? "Order partially matched, remainder added to book"
+                         : "Order matched";
   }
 
-  void sendBinaryResponse(int clientSocket,
+  static const char *describeFailure(OrderAction action) {
+    switch (action) {
+    case OrderAction::CANCEL:
+      return "Order not found";
+    case OrderAction::REPLACE:
+      return "Order not found or cannot be replaced";
+    default:
+      return "Failed to add order";
+    }
+  }
+
+  // Replies are queued on the connection, the backend writes them out
+  // One JSON reply per line, like the requests
+  void sendResponse(Connection &connection, const std::string &response) {
+    connection.queue(response.data(), response.length());
+    connection.queue("\n", 1);
+  }
+
+  void sendJsonError(Connection &connection, const char *message) {
+    std::string response = "{\"status\":\"error\",\"message\":" +
+                           nlohmann::json(message).dump() + "}";
+    sendResponse(connection, response);
+  }
+
+  void sendBinaryResponse(Connection &connection,
                           const std::vector<uint8_t> &response) {
-    send(clientSocket, response.data(), response.size(), 0);
+    connection.queue(response.data(), response.size());
   }
 
-  void sendBinaryError(int clientSocket, const std::string &message) {
+  void sendBinaryError(Connection &connection, std::string_view message) {
 
     struct ErrorResponse {
       MessageHeader header;
@@ -449,13 +1016,28 @@ private:
     response.header.type = MessageType::ORDER_ACK;
     response.header.length = sizeof(ErrorResponse) - sizeof(MessageHeader);
     response.header.seq_num = BinaryProtocol::hton32(_market_data_seq++);
-    strncpy(response.message, message.c_str(), sizeof(response.message) - 1);
+    message.copy(response.message, sizeof(response.message) - 1);
 
-    send(clientSocket, &response, sizeof(response), 0);
+    connection.queue(&response, sizeof(response));
   }
 
-  void sendBinaryOrderResponse(int clientSocket, uint64_t order_id,
-                               bool success, const std::string &message) {
+  // Acks are already in network byte order
+  void sendOrderAckBatch(Connection &connection,
+                         std::span<const BatchAck> acks) {
+    OrderAckBatchMessage header{};
+    header.header.type = MessageType::ORDER_ACK_BATCH;
+    header.header.length = BinaryProtocol::hton16(
+        sizeof(OrderAckBatchMessage) - sizeof(MessageHeader) +
+        acks.size_bytes());
+    header.header.seq_num = BinaryProtocol::hton32(_market_data_seq++);
+    header.ack_count = BinaryProtocol::hton16(acks.size());
+
+    connection.queue(&header, sizeof(header));
+    connection.queue(acks.data(), acks.size_bytes());
+  }
+
+  void sendBinaryOrderResponse(Connection &connection, uint64_t order_id,
+                               bool success, std::string_view message) {
 
     struct OrderResponse {
       MessageHeader header;
@@ -469,19 +1051,27 @@ private:
     response.header.seq_num = BinaryProtocol::hton32(_market_data_seq++);
     response.order_id = BinaryProtocol::hton64(order_id);
     response.success = success ? 1 : 0;
-    strncpy(response.message, message.c_str(), sizeof(response.message) - 1);
+    message.copy(response.message, sizeof(response.message) - 1);
+
+    connection.queue(&response, sizeof(response));
+  }
 
-    send(clientSocket, &response, sizeof(response), 0);
+  // Fixed-width name fields are only null-terminated when they are short
+  template <size_t N> static std::string fixedString(const char (&field)[N]) {
+    return std::string(field, strnlen(field, N));
   }
 
 private:
+  static constexpr size_t MAX_FILLS_PER_SWEEP = 64;
+  static constexpr size_t MAX_SESSIONS = 1024;
+
+  using SessionRefs = session::InternTable<session::Session, MAX_SESSIONS>;
+
   int _serverSocket;
   uint16_t _port;
   std::atomic<bool> _running;
-  std::thread _acceptThread;
-  ThreadPool _thread_pool;
-  std::vector<std::thread> _clientThreads;
-  std::mutex _threads_mutex;
+  ShardedEngine _shards; // matching, one thread per shard of books
+  std::unique_ptr<IoBackend> _backend;
 
   bool _use_binary_protocol;
   std::unique_ptr<MarketDataPublisher> _market_data_publisher;
@@ -490,11 +1080,14 @@ private:
   ZeroCopyHandler _zero_copy_handler;
 
   std::unordered_map<std::string, std::unique_ptr<session::Session>> _sessions;
+  std::unordered_map<std::string, uint32_t> _session_ref_by_id;
+  SessionRefs _session_refs; // sessions by the ref handed out at JOIN
   std::mutex _sessions_mutex;
 };
 
-NetworkServer::NetworkServer(uint16_t port, bool use_binary_protocol)
-    : _pimpl(new Impl(port, use_binary_protocol)) {}
+NetworkServer::NetworkServer(uint16_t port, bool use_binary_protocol,
+                             IoBackendType backend)
+    : _pimpl(new Impl(port, use_binary_protocol, backend)) {}
 
 NetworkServer::~NetworkServer() { delete _pimpl; }
 
@@ -516,7 +1109,7 @@ void NetworkServer::enableMarketData(const std::string &multicast_addr,
 }
 
 void NetworkServer::publishMarketData(const std::string &symbol,
-                                      double best_bid, double best_ask,
+                                      int64_t best_bid, int64_t best_ask,
                                       uint32_t bid_size, uint32_t ask_size) {
   _pimpl->publishMarketData(symbol, best_bid, best_ask, bid_size, ask_size);
 }
@@ -0,0 +1,147 @@
+#include "../../include/network/sharded_engine.hpp"
+
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#endif
+
+namespace network {
+
+ShardedEngine::ShardedEngine(size_t num_shards, size_t ring_capacity) {
+  if (num_shards == 0) {
+    throw std::invalid_argument("Sharded engine needs at least one shard");
+  }
+
+  _shards.reserve(num_shards);
+  for (size_t i = 0; i < num_shards; ++i) {
+    _shards.push_back(std::make_unique<Shard>(ring_capacity));
+  }
+  for (size_t i = 0; i < num_shards; ++i) {
+    Shard &shard = *_shards[i];
+    shard.thread = std::thread(&ShardedEngine::run, this, std::ref(shard));
+    pinToCore(shard.thread, i);
+  }
+}
+
+ShardedEngine::~ShardedEngine() { stop(); }
+
+size_t ShardedEngine::shardFor(const std::string &session_id,
+                               const std::string &symbol) const {
+  size_t seed = std::hash<std::string>{}(session_id);
+  seed ^= std::hash<std::string>{}(symbol) + 0x9e3779b97f4a7c15ULL +
+          (seed << 6) + (seed >> 2);
+  return seed % _shards.size();
+}
+
+bool ShardedEngine::tryPost(size_t shard, Task task) {
+  // Announce the post before checking _running so stop() can wait it out
+  _posting.fetch_add(1);
+  if (!_running.load()) {
+    _posting.fetch_sub(1);
+    return false;
+  }
+  Shard &target = *_shards[shard];
+  bool pushed = target.ring.tryPush(std::move(task));
+  if (pushed) {
+    target.signal.fetch_add(1, std::memory_order_release);
+    target.signal.notify_one();
+  }
+  _posting.fetch_sub(1);
+  return pushed;
+}
+
+bool ShardedEngine::post(size_t shard, Task task) {
+  while (_running.load(std::memory_order_acquire)) {
+    if (tryPost(shard, task)) {
+      return true;
+    }
+    std::this_thread::yield();
+  }
+  return false;
+}
+
+void ShardedEngine::stop() {
+  if (!_running.exchange(false)) {
+    return;
+  }
+  while (_posting.load() != 0) {
+    std::this_thread::yield();
+  }
+  _quiesced.store(true, std::memory_order_release);
+  for (auto &shard : _shards) {
+    shard->signal.fetch_add(1, std::memory_order_release);
+    shard->signal.notify_one();
+  }
+  for (auto &shard : _shards) {
+    if (shard->thread.joinable()) {
+      shard->thread.join();
+    }
+  }
+}
+
+size_t ShardedEngine::getShardCount() const { return _shards.size(); }
+
+void ShardedEngine::run(Shard &shard) {
+  // Spin briefly before parking so bursts are picked up without a wakeup
+  constexpr int SPINS_BEFORE_WAIT = 256;
+  Task task;
+  int idle = 0;
+
+  while (true) {
+    if (shard.ring.tryPop(task)) {
+      task();
+      task = nullptr;
+      idle = 0;
+      continue;
+    }
+
+    if (_quiesced.load(std::memory_order_acquire)) {
+      // Posts that raced with stop() are still in the ring, run them
+      while (shard.ring.tryPop(task)) {
+        task();
+      }
+      return;
+    }
+
+    if (++idle < SPINS_BEFORE_WAIT) {
+      continue;
+    }
+    uint32_t seen = shard.signal.load(std::memory_order_acquire);
+    if (shard.ring.isEmpty() && !_quiesced.load(std::memory_order_acquire)) {
+      shard.signal.wait(seen, std::memory_order_acquire);
+    }
+    idle = 0;
+  }
+}
+
+// Best effort, an unpinned shard still works, it just may migrate
+void ShardedEngine::pinToCore(std::thread &thread, size_t core) {
+  unsigned int cores = std::thread::hardware_concurrency();
+  if (cores == 0) {
+    return;
+  }
+#if defined(__linux__)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(core % cores, &cpuset);
+  pthread_setaffinity_np(thread.native_handle(), sizeof(cpuset), &cpuset);
+#elif defined(__APPLE__)
+  // macOS has no hard pinning, distinct affinity tags keep shards apart
+  thread_affinity_policy_data_t policy{static_cast<integer_t>(core + 1)};
+  thread_policy_set(pthread_mach_thread_np(thread.native_handle()),
+                    THREAD_AFFINITY_POLICY,
+                    reinterpret_cast<thread_policy_t>(&policy),
+                    THREAD_AFFINITY_POLICY_COUNT);
+#else
+  (void)thread;
+  (void)core;
+#endif
+}
+
+} // namespace network
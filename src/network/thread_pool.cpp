@@ -16,17 +16,21 @@ void ThreadPool::init(int num) {
   });
 }
 
+// Busy workers pop without a lock, only an empty queue takes the mutex to
+// wait on the condition
 void ThreadPool::spawn() {
   while (true) {
-    std::function<void()> task;
-    bool hasTask = false;
+    InlineTask task;
+    bool hasTask = !_isCancelled.load() && _tasks.tryPop(task);
 
-    {
+    if (!hasTask) {
       writelock lock(_mutex);
+      _idle.fetch_add(1);
       _condition.wait(lock, [this, &hasTask, &task] {
         hasTask = _tasks.tryPop(task);
         return _isCancelled.load() || _hasStopped.load() || hasTask;
       });
+      _idle.fetch_sub(1);
     }
 
     if (_isCancelled.load() || (_hasStopped.load() && !hasTask)) {
@@ -39,6 +43,18 @@ void ThreadPool::spawn() {
   }
 }
 
+// The task is queued before _idle is read, and a worker counts itself idle
+// before its last look at the queue, so one of the two always sees the other.
+// Taking the mutex means a worker that has looked is already waiting.
+void ThreadPool::wakeIdle() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_idle.load() == 0) {
+    return;
+  }
+  { writelock lock(_mutex); }
+  _condition.notify_one();
+}
+
 void ThreadPool::terminate() {
   {
     writelock lock(_mutex);
@@ -0,0 +1,647 @@
+#include "../../include/network/uring_backend.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+
+#include "../../include/network/zero_copy.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace network {
+
+namespace {
+
+constexpr unsigned RING_ENTRIES = 1024;
+constexpr unsigned BUFFER_COUNT = 512; // power of two
+constexpr unsigned BUFFER_SIZE = 4096;
+constexpr uint16_t BUFFER_GROUP = 0;
+
+// The low bits of user_data name the operation, the rest is its client
+enum Op : uint64_t { ACCEPT = 1, RECV = 2, SEND = 3, WAKE = 4, CANCEL = 5 };
+constexpr uint64_t OP_MASK = 7;
+
+uint64_t tag(const void *target, Op op) {
+  return reinterpret_cast<uint64_t>(target) | op;
+}
+
+int ioUringSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void *arg, unsigned count) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+template <class T> T *offsetPtr(void *base, uint32_t offset) {
+  return reinterpret_cast<T *>(static_cast<uint8_t *>(base) + offset);
+}
+
+// The submission and completion queues the kernel shares with us
+class Ring {
+public:
+  explicit Ring(unsigned entries) {
+    io_uring_params params{};
+    _fd = ioUringSetup(entries, &params);
+    if (_fd < 0) {
+      throw std::runtime_error("io_uring_setup failed: " +
+                               std::string(strerror(errno)));
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+        !(params.features & IORING_FEAT_NODROP)) {
+      close(_fd);
+      throw std::runtime_error("io_uring is too old for the server");
+    }
+
+    // With SINGLE_MMAP both queues live in one mapping
+    _rings_size = std::max(
+        params.sq_off.array + params.sq_entries * sizeof(unsigned),
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    _rings = mmap(nullptr, _rings_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+    if (_rings == MAP_FAILED || sqes == MAP_FAILED) {
+      close(_fd);
+      throw std::runtime_error("Failed to map io_uring queues");
+    }
+    _sqes = static_cast<io_uring_sqe *>(sqes);
+
+    _sq_head = offsetPtr<unsigned>(_rings, params.sq_off.head);
+    _sq_tail = offsetPtr<unsigned>(_rings, params.sq_off.tail);
+    _sq_array = offsetPtr<unsigned>(_rings, params.sq_off.array);
+    _sq_mask = *offsetPtr<unsigned>(_rings, params.sq_off.ring_mask);
+    _sq_entries = params.sq_entries;
+    _cq_head = offsetPtr<unsigned>(_rings, params.cq_off.head);
+    _cq_tail = offsetPtr<unsigned>(_rings, params.cq_off.tail);
+    _cq_mask = *offsetPtr<unsigned>(_rings, params.cq_off.ring_mask);
+    _cqes = offsetPtr<io_uring_cqe>(_rings, params.cq_off.cqes);
+    _tail = *_sq_tail;
+  }
+
+  ~Ring() {
+    munmap(_sqes, _sqes_size);
+    munmap(_rings, _rings_size);
+    close(_fd);
+  }
+
+  Ring(const Ring &) = delete;
+  Ring &operator=(const Ring &) = delete;
+
+  int fd() const { return _fd; }
+
+  // A zeroed SQE. A full queue is handed to the kernel first, and if the
+  // kernel will not take it yet the SQE waits in a backlog, in order, for
+  // a later enter to move over.
+  io_uring_sqe *nextSqe() {
+    if (_backlog.empty() && sqFull()) {
+      enter(0);
+    }
+    io_uring_sqe *sqe = !_backlog.empty() || sqFull()
+                            ? &_backlog.emplace_back()
+                            : claimSqe();
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  }
+
+  // Submits everything queued and waits for at least one completion.
+  // Returns 0 or the errno io_uring_enter failed with, see enter().
+  int submitAndWait() { return enter(1); }
+  int submit() { return enter(0); }
+
+  template <class F> void forEachCompletion(F &&f) {
+    unsigned head = *_cq_head;
+    unsigned tail = std::atomic_ref(*_cq_tail).load(std::memory_order_acquire);
+    for (; head != tail; ++head) {
+      io_uring_cqe cqe = _cqes[head & _cq_mask];
+      // Release the slot before handling, handlers may queue more work
+      std::atomic_ref(*_cq_head).store(head + 1, std::memory_order_release);
+      f(cqe);
+    }
+  }
+
+private:
+  bool sqFull() const {
+    unsigned head = std::atomic_ref(*_sq_head).load(std::memory_order_acquire);
+    return _tail - head >= _sq_entries;
+  }
+
+  io_uring_sqe *claimSqe() {
+    unsigned index = _tail & _sq_mask;
+    _sq_array[index] = index;
+    ++_tail;
+    ++_pending;
+    return &_sqes[index];
+  }
+
+  // Submits the queue and any backlog, waiting for `min_complete`
+  // completions once nothing is left over. EBUSY and EAGAIN mean the kernel
+  // will take no more until completions are reaped; whatever it did not
+  // take stays queued. Never throws, it runs on the loop thread.
+  int enter(unsigned min_complete) {
+    while (true) {
+      while (!_backlog.empty() && !sqFull()) {
+        *claimSqe() = _backlog.front();
+        _backlog.pop_front();
+      }
+      std::atomic_ref(*_sq_tail).store(_tail, std::memory_order_release);
+      bool last = _backlog.empty();
+      unsigned wait = last ? min_complete : 0;
+      unsigned flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+      int submitted = ioUringEnter(_fd, _pending, wait, flags);
+      if (submitted < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return errno;
+      }
+      _pending -= submitted;
+      if (last) {
+        return 0;
+      }
+    }
+  }
+
+  int _fd{-1};
+  void *_rings{nullptr};
+  size_t _rings_size{0};
+  io_uring_sqe *_sqes{nullptr};
+  size_t _sqes_size{0};
+  unsigned *_sq_head, *_sq_tail, *_sq_array;
+  unsigned _sq_mask, _sq_entries;
+  unsigned *_cq_head, *_cq_tail;
+  unsigned _cq_mask;
+  io_uring_cqe *_cqes;
+  unsigned _tail{0};    // next free SQE, published on enter
+  unsigned _pending{0}; // queued but not yet taken by the kernel
+  std::deque<io_uring_sqe> _backlog; // waiting for room in the queue
+};
+
+// Receive buffers the kernel picks from as data arrives, so an idle client
+// pins no memory. Each buffer goes back on the ring once it is copied out.
+class BufferRing {
+public:
+  BufferRing(Ring &ring, unsigned count, unsigned size)
+      : _ring(ring), _count(count), _size(size),
+        _memory(new uint8_t[static_cast<size_t>(count) * size]) {
+    _entries_size = count * sizeof(io_uring_buf);
+    void *entries = mmap(nullptr, _entries_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (entries == MAP_FAILED) {
+      throw std::runtime_error("Failed to map io_uring buffer ring");
+    }
+    _entries = static_cast<io_uring_buf_ring *>(entries);
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(_entries);
+    reg.ring_entries = count;
+    reg.bgid = BUFFER_GROUP;
+    if (ioUringRegister(ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+      munmap(_entries, _entries_size);
+      throw std::runtime_error("io_uring buffer rings need Linux 5.19+");
+    }
+    for (unsigned id = 0; id < count; ++id) {
+      recycle(static_cast<uint16_t>(id));
+    }
+    publish();
+  }
+
+  ~BufferRing() {
+    io_uring_buf_reg reg{};
+    reg.bgid = BUFFER_GROUP;
+    ioUringRegister(_ring.fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    munmap(_entries, _entries_size);
+  }
+
+  BufferRing(const BufferRing &) = delete;
+  BufferRing &operator=(const BufferRing &) = delete;
+
+  const uint8_t *data(uint16_t id) const {
+    return _memory.get() + static_cast<size_t>(id) * _size;
+  }
+
+  // Staged until publish(), which hands every recycled buffer back at once
+  void recycle(uint16_t id) {
+    // Not _entries->bufs, whose flexible array member C++ lays out after
+    // a padded empty struct rather than at offset zero
+    auto *entries = reinterpret_cast<io_uring_buf *>(_entries);
+    io_uring_buf &entry = entries[_tail & (_count - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(data(id));
+    entry.len = _size;
+    entry.bid = id;
+    ++_tail;
+  }
+
+  void publish() {
+    std::atomic_ref(_entries->tail).store(_tail, std::memory_order_release);
+  }
+
+private:
+  Ring &_ring;
+  unsigned _count;
+  unsigned _size;
+  std::unique_ptr<uint8_t[]> _memory;
+  io_uring_buf_ring *_entries{nullptr};
+  size_t _entries_size{0};
+  uint16_t _tail{0};
+};
+
+struct Client : Connection {
+  Client(int fd, ConnectionLoop *loop) : Connection(fd, loop) {}
+
+  std::vector<uint8_t> sending; // read by the kernel while a send is out
+  size_t sending_offset{0};
+  int in_flight{0}; // recv and send SQEs not yet retired
+  bool recv_armed{false};
+  bool send_armed{false};
+  bool closing{false};
+  bool touched{false}; // queued for service after this batch
+  bool resumed{false}; // onResumed is due
+};
+
+} // namespace
+
+class UringBackend::Loop : public ConnectionLoop {
+public:
+  explicit Loop(ConnectionHandler &handler)
+      : _handler(handler), _ring(RING_ENTRIES),
+        _buffers(_ring, BUFFER_COUNT, BUFFER_SIZE) {
+    _wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (_wake_fd < 0) {
+      throw std::runtime_error("Failed to create event loop");
+    }
+  }
+
+  ~Loop() {
+    // Only a loop that gave up on its ring still has clients here
+    for (auto &[fd, _] : _clients) {
+      close(fd);
+    }
+    close(_wake_fd);
+  }
+
+  void run(int listen_fd) {
+    _listen_fd = listen_fd;
+    _stopping = false;
+    armWake();
+    armAccept();
+
+    while (true) {
+      int error = _ring.submitAndWait();
+      if (error == EBUSY || error == EAGAIN) {
+        // Reap what is waiting below, the rest goes in on the next turn
+        std::this_thread::yield();
+      } else if (error != 0) {
+        std::cerr << "io_uring_enter failed: " << strerror(error)
+                  << std::endl;
+        abandon();
+        return;
+      }
+      _ring.forEachCompletion(
+          [this](const io_uring_cqe &cqe) { complete(cqe); });
+      _buffers.publish();
+      serviceTouched();
+      if (_stopping && !_accept_armed && _clients.empty()) {
+        break;
+      }
+    }
+  }
+
+  void stop() {
+    _stop_requested.store(true, std::memory_order_release);
+    wake();
+  }
+
+  void resume(Connection &connection) override {
+    if (_resumed.push(connection)) {
+      wake();
+    }
+  }
+
+  std::thread thread;
+
+private:
+  void complete(const io_uring_cqe &cqe) {
+    auto op = static_cast<Op>(cqe.user_data & OP_MASK);
+    auto *client = reinterpret_cast<Client *>(cqe.user_data & ~OP_MASK);
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+
+    switch (op) {
+    case ACCEPT:
+      onAccept(cqe.res, more);
+      break;
+    case RECV:
+      onRecv(*client, cqe, more);
+      break;
+    case SEND:
+      onSend(*client, cqe.res);
+      break;
+    case WAKE:
+      onWake();
+      break;
+    case CANCEL:
+      break;
+    }
+  }
+
+  // The wake fd is read again every time, clients may still be resumed
+  // while the loop stops
+  void onWake() {
+    if (_stop_requested.load(std::memory_order_acquire) && !_stopping) {
+      beginStop();
+    }
+    Connection *next = _resumed.takeAll();
+    while (next) {
+      auto &client = static_cast<Client &>(*next);
+      next = client.next_resumed;
+      client.suspended = false;
+      client.resumed = true;
+      touch(client);
+    }
+    armWake();
+  }
+
+  void onAccept(int result, bool more) {
+    if (!more) {
+      _accept_armed = false;
+    }
+    if (result >= 0) {
+      if (_stopping || !SocketOptimiser::optimiseSocket(result)) {
+        close(result);
+      } else {
+        auto client = std::make_unique<Client>(result, this);
+        armRecv(*client);
+        _clients.emplace(result, std::move(client));
+      }
+    } else if (result != -ECANCELED && result != -EAGAIN) {
+      std::cerr << "Failed to accept connection: " << strerror(-result)
+                << std::endl;
+    }
+    if (!_accept_armed && !_stopping) {
+      armAccept();
+    }
+  }
+
+  void onRecv(Client &client, const io_uring_cqe &cqe, bool more) {
+    if (!more) {
+      client.recv_armed = false;
+      --client.in_flight;
+      touch(client);
+    }
+    if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+      auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+      client.input.append(_buffers.data(id), cqe.res);
+      _buffers.recycle(id);
+      touch(client);
+    }
+
+    if (client.recv_armed || client.closing) {
+      return;
+    }
+    // Out of buffers ends the multishot recv but not the connection
+    if (cqe.res > 0 || cqe.res == -ENOBUFS) {
+      armRecv(client);
+    } else {
+      beginClose(client);
+    }
+  }
+
+  void onSend(Client &client, int result) {
+    client.send_armed = false;
+    --client.in_flight;
+    touch(client);
+    if (result < 0) {
+      beginClose(client);
+      return;
+    }
+    client.sending_offset += result;
+    if (client.sending_offset < client.sending.size() && !client.closing) {
+      armSend(client); // the socket took part of it
+    }
+  }
+
+  // Runs the handler once per client that received data in this batch and
+  // queues a send for whatever it replied
+  void serviceTouched() {
+    // Indexed, a handler failure may still append to the list
+    for (size_t i = 0; i < _touched.size(); ++i) {
+      Client *client = _touched[i];
+      Connection &connection = *client;
+
+      bool resumed = std::exchange(client->resumed, false);
+      if (!client->closing && (resumed || (!connection.suspended &&
+                                           !connection.input.empty()))) {
+        try {
+          if (resumed) {
+            _handler.onResumed(connection);
+          } else {
+            _handler.onReadable(connection);
+          }
+        } catch (const std::exception &e) {
+          std::cerr << "Client handler error: " << e.what() << std::endl;
+          beginClose(*client);
+        }
+      }
+
+      if (!client->closing && !client->send_armed &&
+          !connection.output.empty()) {
+        client->sending.swap(connection.output);
+        client->sending_offset = 0;
+        connection.output.clear();
+        armSend(*client);
+      }
+
+      client->touched = false;
+      // A suspended client is still referred to by work on another thread
+      if (client->closing && client->in_flight == 0 && !client->suspended) {
+        int fd = connection.fd;
+        close(fd);
+        _clients.erase(fd); // destroys `client`
+      }
+    }
+    _touched.clear();
+  }
+
+  void touch(Client &client) {
+    if (!client.touched) {
+      client.touched = true;
+      _touched.push_back(&client);
+    }
+  }
+
+  // Shutting the socket down completes whatever is still in flight, the
+  // client is freed once the last of it has been reaped
+  void beginClose(Client &client) {
+    if (client.closing) {
+      return;
+    }
+    client.closing = true;
+    _handler.onClosed(client);
+    shutdown(client.fd, SHUT_RDWR);
+    touch(client);
+  }
+
+  void beginStop() {
+    _stopping = true;
+    for (auto &[_, client] : _clients) {
+      beginClose(*client);
+    }
+    if (_accept_armed) {
+      io_uring_sqe *sqe = _ring.nextSqe();
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = tag(nullptr, ACCEPT);
+      sqe->user_data = tag(nullptr, CANCEL);
+    }
+  }
+
+  // The ring can no longer be driven. Every client is closed as though it
+  // had hung up and the loop stops without reaping, so clients stay
+  // allocated, and their sockets open, until the loop is destroyed. That
+  // waits for suspended clients to be handed back first.
+  void abandon() {
+    beginStop();
+    _ring.submit(); // best effort at cancelling the accept
+    _touched.clear();
+    size_t suspended = 0;
+    for (auto &[_, client] : _clients) {
+      suspended += client->suspended;
+    }
+    // Polled with a timeout, the wake read still armed on the ring may be
+    // the one that consumes the count
+    while (true) {
+      for (Connection *next = _resumed.takeAll(); next;
+           next = next->next_resumed) {
+        next->suspended = false;
+        --suspended;
+      }
+      if (suspended == 0) {
+        break;
+      }
+      pollfd wake{_wake_fd, POLLIN, 0};
+      poll(&wake, 1, 10);
+    }
+  }
+
+  void armAccept() {
+    io_uring_sqe *sqe = _ring.nextSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = _listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = tag(nullptr, ACCEPT);
+    _accept_armed = true;
+  }
+
+  void armRecv(Client &client) {
+    io_uring_sqe *sqe = _ring.nextSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = client.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = tag(&client, RECV);
+    client.recv_armed = true;
+    ++client.in_flight;
+  }
+
+  void armSend(Client &client) {
+    io_uring_sqe *sqe = _ring.nextSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = client.fd;
+    const uint8_t *pending = client.sending.data() + client.sending_offset;
+    sqe->addr = reinterpret_cast<uint64_t>(pending);
+    sqe->len = client.sending.size() - client.sending_offset;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = tag(&client, SEND);
+    client.send_armed = true;
+    ++client.in_flight;
+  }
+
+  void wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(_wake_fd, &one, sizeof(one));
+  }
+
+  void armWake() {
+    io_uring_sqe *sqe = _ring.nextSqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = _wake_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&_wake_value);
+    sqe->len = sizeof(_wake_value);
+    sqe->user_data = tag(nullptr, WAKE);
+  }
+
+  ConnectionHandler &_handler;
+  Ring _ring;
+  BufferRing _buffers;
+  int _wake_fd{-1};
+  uint64_t _wake_value{0};
+  std::atomic<bool> _stop_requested{false};
+  ResumeQueue _resumed;
+  int _listen_fd{-1};
+  bool _accept_armed{false};
+  bool _stopping{false};
+  std::unordered_map<int, std::unique_ptr<Client>> _clients;
+  std::vector<Client *> _touched;
+};
+
+UringBackend::UringBackend(ConnectionHandler &handler, size_t num_loops)
+    : _handler(handler) {
+  if (num_loops == 0) {
+    throw std::invalid_argument("io_uring backend needs at least one loop");
+  }
+  for (size_t i = 0; i < num_loops; ++i) {
+    _loops.push_back(std::make_unique<Loop>(handler));
+  }
+}
+
+UringBackend::~UringBackend() { stop(); }
+
+void UringBackend::start(int listen_fd) {
+  if (_running.exchange(true)) {
+    return;
+  }
+  for (auto &loop : _loops) {
+    loop->thread = std::thread(&Loop::run, loop.get(), listen_fd);
+  }
+}
+
+void UringBackend::stop() {
+  if (!_running.exchange(false)) {
+    return;
+  }
+  for (auto &loop : _loops) {
+    loop->stop();
+  }
+  for (auto &loop : _loops) {
+    if (loop->thread.joinable()) {
+      loop->thread.join();
+    }
+  }
+}
+
+size_t UringBackend::getThreadCount() const { return _loops.size(); }
+
+} // namespace network
+
+#endif
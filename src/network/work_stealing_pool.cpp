@@ -0,0 +1,198 @@
+#include "../../include/network/work_stealing_pool.hpp"
+
+namespace network {
+
+namespace {
+
+// Set on pool workers so their submits go straight to their own deque
+thread_local const WorkStealingPool *current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+constexpr size_t INJECTED_CAPACITY = 4096;
+// Nodes kept for reuse, past this a finished task's node is freed
+constexpr size_t SPARE_CAPACITY = 4096;
+
+} // namespace
+
+WorkStealingPool::~WorkStealingPool() {
+  terminate();
+  Task *task = nullptr;
+  while (_spare && _spare->tryPop(task)) {
+    delete task;
+  }
+}
+
+void WorkStealingPool::init(int num) {
+  std::call_once(_once, [this, num]() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _hasStopped.store(false);
+    _isCancelled.store(false);
+    _injected = std::make_unique<RingQueue<Task *>>(INJECTED_CAPACITY);
+    _spare = std::make_unique<RingQueue<Task *>>(SPARE_CAPACITY);
+
+    _workers.reserve(num);
+    for (int i = 0; i < num; ++i) {
+      _workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < num; ++i) {
+      _workers[i]->thread = std::thread(&WorkStealingPool::run, this, i);
+    }
+    _isInitialised.store(true);
+  });
+}
+
+void WorkStealingPool::enqueue(Task *task) {
+  if (current_pool == this) {
+    _workers[current_worker]->deque.push(task);
+  } else {
+    if (!_injected) {
+      delete task;
+      throw std::runtime_error("Thread pool has not been initialised");
+    }
+    while (!_injected->tryPush(task)) {
+      if (_hasStopped.load() || _isCancelled.load()) {
+        recycle(task);
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  // Pairs with the fence in run(): either a parking worker sees the task
+  // on its last look, or we see it parking and wake it
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_sleeping.load(std::memory_order_relaxed) > 0) {
+    wake();
+  }
+}
+
+void WorkStealingPool::recycle(Task *task) {
+  *task = Task();
+  if (!_spare->tryPush(task)) {
+    delete task;
+  }
+}
+
+void WorkStealingPool::wake() {
+  _signal.fetch_add(1, std::memory_order_release);
+  _signal.notify_one();
+}
+
+WorkStealingPool::Task *WorkStealingPool::findTask(size_t index) {
+  if (Task *task = _workers[index]->deque.pop()) {
+    return task;
+  }
+  Task *task = nullptr;
+  if (_injected->tryPop(task)) {
+    return task;
+  }
+  size_t count = _workers.size();
+  for (size_t i = 1; i < count; ++i) {
+    if (Task *stolen = _workers[(index + i) % count]->deque.steal()) {
+      return stolen;
+    }
+  }
+  return nullptr;
+}
+
+void WorkStealingPool::run(size_t index) {
+  // Spin briefly before parking so bursts are picked up without a wakeup
+  constexpr int SPINS_BEFORE_WAIT = 256;
+  current_pool = this;
+  current_worker = index;
+  int idle = 0;
+
+  while (!_isCancelled.load(std::memory_order_acquire)) {
+    if (Task *task = findTask(index)) {
+      (*task)();
+      recycle(task);
+      idle = 0;
+      continue;
+    }
+    if (_hasStopped.load(std::memory_order_acquire)) {
+      return;
+    }
+    if (++idle < SPINS_BEFORE_WAIT) {
+      continue;
+    }
+
+    uint32_t seen = _signal.load(std::memory_order_acquire);
+    _sleeping.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Task *task = findTask(index);
+    if (!task && !_hasStopped.load() && !_isCancelled.load()) {
+      _signal.wait(seen, std::memory_order_acquire);
+    }
+    _sleeping.fetch_sub(1);
+    if (task) {
+      (*task)();
+      recycle(task);
+    }
+    idle = 0;
+  }
+}
+
+void WorkStealingPool::join() {
+  _signal.fetch_add(1, std::memory_order_release);
+  _signal.notify_all();
+  for (auto &worker : _workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+void WorkStealingPool::terminate() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_isInitialised.load() || _hasStopped.load() || _isCancelled.load())
+      return;
+    _hasStopped.store(true);
+  }
+  join();
+
+  // Submits that raced with terminate() are still queued, run them
+  Task *task = nullptr;
+  while (_injected->tryPop(task)) {
+    (*task)();
+    recycle(task);
+  }
+}
+
+void WorkStealingPool::cancel() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_isInitialised.load() || _hasStopped.load() || _isCancelled.load())
+      return;
+    _isCancelled.store(true);
+  }
+  join();
+  discardQueued();
+}
+
+// Workers are joined, so this thread may pop their deques
+void WorkStealingPool::discardQueued() {
+  for (auto &worker : _workers) {
+    while (Task *task = worker->deque.pop()) {
+      recycle(task);
+    }
+  }
+  Task *task = nullptr;
+  while (_injected->tryPop(task)) {
+    recycle(task);
+  }
+}
+
+bool WorkStealingPool::isInitialised() const { return _isInitialised.load(); }
+
+bool WorkStealingPool::isRunning() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _isInitialised.load() && !_hasStopped.load() && !_isCancelled.load();
+}
+
+size_t WorkStealingPool::getSize() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _workers.size();
+}
+
+} // namespace network
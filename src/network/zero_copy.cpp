@@ -1,4 +1,6 @@
 #include "../../include/network/zero_copy.hpp"
+#include <cstring>
+#include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <unistd.h>
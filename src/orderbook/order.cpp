@@ -2,12 +2,16 @@
 
 namespace orderbook {
 
-Order::Order(uint64_t id, Side side, double price, uint32_t quantity)
-    : _id(id), _side(side), _price(price), _quantity(quantity) {}
+Order::Order(uint64_t id, Side side, Price price, uint32_t quantity,
+             uint32_t owner)
+    : _id(id), _side(side), _owner(owner), _price(price), _quantity(quantity),
+      _leaves_quantity(quantity) {}
 
 uint64_t Order::getId() const { return _id; }
 Side Order::getSide() const { return _side; }
-double Order::getPrice() const { return _price; }
+Price Order::getPrice() const { return _price; }
 uint32_t Order::getQuantity() const { return _quantity; }
+uint32_t Order::getLeavesQuantity() const { return _leaves_quantity; }
+uint32_t Order::getOwner() const { return _owner; }
 
 } // namespace orderbook
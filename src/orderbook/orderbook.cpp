@@ -1,221 +1,688 @@
 #include "../../include/orderbook/orderbook.hpp"
-#include "../../include/network/thread_pool.hpp"
+#include "../../include/network/task_queue.hpp"
+#include "../../include/orderbook/order_allocator.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace orderbook {
 
 class OrderBook::Impl {
 public:
-  Impl() : _thread_pool(std::make_unique<network::ThreadPool>()) {
-    // Initialise with less threads to avoid oversubscription
-    _thread_pool->init(std::max(2u, std::thread::hardware_concurrency() / 2));
-  }
-
+  // Resting orders form an intrusive FIFO of nodes owned by the book, so
+  // fills pop the head and cancels unlink in place without moving anything.
   struct PriceLevel {
-    std::vector<Order> orders;
-    double total_quantity{0.0};
+    Price price{0};
+    Order *head{nullptr};
+    Order *tail{nullptr};
+    size_t count{0};
+    uint64_t total_quantity{0}; // sum of leaves over the queue
+
+    void push(Order *order);
+    void unlink(Order *order);
   };
 
-  std::map<double, PriceLevel, std::greater<>> _bids; // Higher prices first
-  std::map<double, PriceLevel> _asks;                 // Lower prices first
+  template <typename Compare> class MapLevels;
+  class LadderLevels;
+  template <typename BidLevels, typename AskLevels> class Engine;
+
+  virtual ~Impl() = default;
+
+  using WriteLock = std::unique_lock<std::shared_mutex>;
+  using ReadLock = std::shared_lock<std::shared_mutex>;
+
+  // The owning thread of a single-writer book needs no lock
+  WriteLock writeLock() {
+    return _mode == WriterMode::SINGLE_WRITER
+               ? WriteLock(_book_mutex, std::defer_lock)
+               : WriteLock(_book_mutex);
+  }
+
+  ReadLock readLock() const {
+    return _mode == WriterMode::SINGLE_WRITER
+               ? ReadLock(_book_mutex, std::defer_lock)
+               : ReadLock(_book_mutex);
+  }
+
+  void publishTopOfBook();
+  TopOfBook readTopOfBook() const;
+
+  // Sweeps the opposing side, then rests any remainder if `rest` is set. With
+  // `record` unset fills are neither written out nor bounded by `fills`.
+  virtual MatchResult execute(const Order &order, std::span<Fill> fills,
+                              bool record, bool rest) = 0;
+  virtual std::optional<Order> frontMatch(const Order &order) const = 0;
+  virtual bool cancelOrder(uint64_t orderId, uint32_t owner) = 0;
+  virtual MatchResult replaceOrder(uint64_t orderId, Side side, Price price,
+                                   uint32_t quantity, std::span<Fill> fills,
+                                   uint32_t owner) = 0;
+  virtual Price getBestBid() const = 0;
+  virtual Price getBestAsk() const = 0;
+  virtual uint64_t getBestBidSize() const = 0;
+  virtual uint64_t getBestAskSize() const = 0;
+  virtual uint64_t getDepth(Side side, Price price) const = 0;
+  virtual void clear() = 0;
+
+  PriceScale _scale;
+  WriterMode _mode{WriterMode::LOCKED};
+  // Backs the level map and order index. Nodes freed when a level or order
+  // goes are kept for the next one, so steady churn never reaches malloc.
+  // Only touched under the write lock or by the single writer.
+  std::pmr::unsynchronized_pool_resource _nodes;
   mutable std::shared_mutex _book_mutex;
-  std::unique_ptr<network::ThreadPool> _thread_pool;
+  network::TaskQueue<BookCommand> _commands;
+
+  // Seqlock over the top of book, on its own cache line so readers polling
+  // it do not share a line with the mutex or the book state
+  struct alignas(64) TopOfBookCell {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<Price> best_bid{0};
+    std::atomic<Price> best_ask{0};
+    std::atomic<uint64_t> bid_size{0};
+    std::atomic<uint64_t> ask_size{0};
+  } _top;
+
+protected:
+  Impl() = default;
 };
 
-OrderBook::OrderBook() : _pimpl(new Impl) {}
-OrderBook::~OrderBook() { delete _pimpl; }
-
-bool OrderBook::addOrder(const Order &order) {
-  std::unique_lock<std::shared_mutex> lock(_pimpl->_book_mutex);
-
-  if (order.getSide() == Side::BUY) {
-    // Try matching with existing sell orders
-    if (!_pimpl->_asks.empty()) {
-      auto ask_it = _pimpl->_asks.begin();
-      if (ask_it->first <= order.getPrice()) {
-        auto &level = ask_it->second;
-        if (!level.orders.empty()) {
-          // Match found
-          auto &matching_order = level.orders.front();
-          uint32_t trade_quantity =
-              std::min(order.getQuantity(), matching_order.getQuantity());
-
-          level.total_quantity -= trade_quantity;
-
-          if (matching_order.getQuantity() == trade_quantity) {
-            level.orders.erase(level.orders.begin());
-            if (level.orders.empty()) {
-              _pimpl->_asks.erase(ask_it);
-            }
-          }
-          return true;
-        }
-      }
-    }
+void OrderBook::Impl::PriceLevel::push(Order *order) {
+  order->_prev = tail;
+  order->_next = nullptr;
+  if (tail) {
+    tail->_next = order;
+  } else {
+    head = order;
+  }
+  tail = order;
+  count++;
+  total_quantity += order->_leaves_quantity;
+}
 
-    // No match found, add to bids
-    auto &level = _pimpl->_bids[order.getPrice()];
-    level.orders.push_back(order);
-    level.total_quantity += order.getQuantity();
+void OrderBook::Impl::PriceLevel::unlink(Order *order) {
+  if (order->_prev) {
+    order->_prev->_next = order->_next;
   } else {
-    // Try matching with existing buy orders
-    if (!_pimpl->_bids.empty()) {
-      auto bid_it = _pimpl->_bids.begin();
-      if (bid_it->first >= order.getPrice()) {
-        auto &level = bid_it->second;
-        if (!level.orders.empty()) {
-          // Match found
-          auto &matching_order = level.orders.front();
-          uint32_t trade_quantity =
-              std::min(order.getQuantity(), matching_order.getQuantity());
-
-          level.total_quantity -= trade_quantity;
-
-          if (matching_order.getQuantity() == trade_quantity) {
-            level.orders.erase(level.orders.begin());
-            if (level.orders.empty()) {
-              _pimpl->_bids.erase(bid_it);
-            }
-          }
-          return true;
-        }
-      }
-    }
+    head = order->_next;
+  }
+  if (order->_next) {
+    order->_next->_prev = order->_prev;
+  } else {
+    tail = order->_prev;
+  }
+  count--;
+  total_quantity -= order->_leaves_quantity;
+}
 
-    // No match found, add to asks
-    auto &level = _pimpl->_asks[order.getPrice()];
-    level.orders.push_back(order);
-    level.total_quantity += order.getQuantity();
+// Only the writer stores, and skips the store when nothing changed so that
+// polling readers keep their cached copy of the line
+void OrderBook::Impl::publishTopOfBook() {
+  const Price best_bid = getBestBid();
+  const Price best_ask = getBestAsk();
+  const uint64_t bid_size = getBestBidSize();
+  const uint64_t ask_size = getBestAskSize();
+  if (best_bid == _top.best_bid.load(std::memory_order_relaxed) &&
+      best_ask == _top.best_ask.load(std::memory_order_relaxed) &&
+      bid_size == _top.bid_size.load(std::memory_order_relaxed) &&
+      ask_size == _top.ask_size.load(std::memory_order_relaxed)) {
+    return;
   }
 
-  return true;
+  const uint64_t seq = _top.seq.load(std::memory_order_relaxed);
+  _top.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _top.best_bid.store(best_bid, std::memory_order_relaxed);
+  _top.best_ask.store(best_ask, std::memory_order_relaxed);
+  _top.bid_size.store(bid_size, std::memory_order_relaxed);
+  _top.ask_size.store(ask_size, std::memory_order_relaxed);
+  _top.seq.store(seq + 2, std::memory_order_release);
 }
 
-void OrderBook::clear() {
-  std::unique_lock<std::shared_mutex> lock(_pimpl->_book_mutex);
-  _pimpl->_bids.clear();
-  _pimpl->_asks.clear();
+TopOfBook OrderBook::Impl::readTopOfBook() const {
+  TopOfBook top;
+  for (;;) {
+    const uint64_t begin = _top.seq.load(std::memory_order_acquire);
+    if (begin & 1) {
+      continue; // write in progress
+    }
+    top.best_bid = _top.best_bid.load(std::memory_order_relaxed);
+    top.best_ask = _top.best_ask.load(std::memory_order_relaxed);
+    top.bid_size = _top.bid_size.load(std::memory_order_relaxed);
+    top.ask_size = _top.ask_size.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_top.seq.load(std::memory_order_relaxed) == begin) {
+      return top;
+    }
+  }
 }
 
-std::optional<Order> OrderBook::matchOrder(const Order &order) {
-  std::unique_lock write_lock(_pimpl->_book_mutex);
+// One side of the book keyed by price in a std::map, any price is accepted
+template <typename Compare> class OrderBook::Impl::MapLevels {
+public:
+  explicit MapLevels(std::pmr::memory_resource *resource)
+      : _levels(resource) {}
 
-  if (order.getSide() == Side::BUY) {
-    if (_pimpl->_asks.empty())
-      return std::nullopt;
+  PriceLevel *best() {
+    return _levels.empty() ? nullptr : &_levels.begin()->second;
+  }
+
+  const PriceLevel *best() const {
+    return _levels.empty() ? nullptr : &_levels.begin()->second;
+  }
+
+  bool accepts(Price) const { return true; }
+
+  const PriceLevel *find(Price price) const {
+    auto it = _levels.find(price);
+    return it == _levels.end() ? nullptr : &it->second;
+  }
+
+  PriceLevel *level(Price price) {
+    auto &level = _levels[price];
+    level.price = price;
+    return &level;
+  }
+
+  void erase(PriceLevel *level) { _levels.erase(level->price); }
+
+  template <typename F> void forEach(F &&f) {
+    for (auto &[price, level] : _levels) {
+      f(level);
+    }
+  }
+
+  void clear() { _levels.clear(); }
 
-    // Try to match with best ask
-    auto ask_it = _pimpl->_asks.begin();
-    if (ask_it->first > order.getPrice()) {
-      return std::nullopt; // No matching price
+private:
+  std::pmr::map<Price, PriceLevel, Compare> _levels;
+};
+
+// One side of the book as a contiguous array of levels indexed by tick
+// within a fixed price band. An occupancy bitmap finds the next non-empty
+// level when the best one empties, and a cursor keeps the best level at hand.
+class OrderBook::Impl::LadderLevels {
+public:
+  LadderLevels(const LadderConfig &config, bool descending,
+               std::pmr::memory_resource *resource)
+      : _config(config), _descending(descending), _levels(resource),
+        _occupied(resource) {
+    if (config.tick_size <= 0 || config.max_price < config.min_price) {
+      throw std::invalid_argument("Invalid ladder configuration");
     }
+    size_t num_levels = static_cast<size_t>(
+        (config.max_price - config.min_price) / config.tick_size + 1);
+    _levels.resize(num_levels);
+    for (size_t i = 0; i < num_levels; ++i) {
+      _levels[i].price =
+          config.min_price + static_cast<Price>(i) * config.tick_size;
+    }
+    _occupied.resize((num_levels + 63) / 64);
+  }
 
-    auto &level = ask_it->second;
-    if (!level.orders.empty()) {
-      // Make a copy of the matching order before potentially erasing it
-      Order matched_order = level.orders.front();
-      uint32_t trade_quantity =
-          std::min(order.getQuantity(), matched_order.getQuantity());
+  PriceLevel *best() { return _best == NONE ? nullptr : &_levels[_best]; }
 
-      level.total_quantity -= trade_quantity;
+  const PriceLevel *best() const {
+    return _best == NONE ? nullptr : &_levels[_best];
+  }
 
-      if (matched_order.getQuantity() == trade_quantity) {
-        level.orders.erase(level.orders.begin());
-        if (level.orders.empty()) {
-          _pimpl->_asks.erase(ask_it);
-        }
-      }
+  bool accepts(Price price) const { return indexOf(price) != NONE; }
 
-      return matched_order;
+  const PriceLevel *find(Price price) const {
+    size_t i = indexOf(price);
+    if (i == NONE || !(_occupied[i / 64] & (uint64_t{1} << (i % 64)))) {
+      return nullptr;
     }
-  } else {
-    if (_pimpl->_bids.empty())
-      return std::nullopt;
+    return &_levels[i];
+  }
+
+  // Returns nullptr for prices off the tick grid or outside the band
+  PriceLevel *level(Price price) {
+    size_t i = indexOf(price);
+    if (i == NONE) {
+      return nullptr;
+    }
+
+    _occupied[i / 64] |= uint64_t{1} << (i % 64);
+    if (_best == NONE || (_descending ? i > _best : i < _best)) {
+      _best = i;
+    }
+    return &_levels[i];
+  }
+
+  void erase(PriceLevel *level) {
+    size_t i = static_cast<size_t>(level - _levels.data());
+    _occupied[i / 64] &= ~(uint64_t{1} << (i % 64));
+    if (i == _best) {
+      _best = nextOccupied(i);
+    }
+  }
 
-    // Try to match with best bid
-    auto bid_it = _pimpl->_bids.begin();
-    if (bid_it->first < order.getPrice()) {
-      return std::nullopt; // No matching price
+  template <typename F> void forEach(F &&f) {
+    for (size_t w = 0; w < _occupied.size(); ++w) {
+      for (uint64_t bits = _occupied[w]; bits; bits &= bits - 1) {
+        f(_levels[w * 64 + std::countr_zero(bits)]);
+      }
     }
+  }
 
-    auto &level = bid_it->second;
-    if (!level.orders.empty()) {
-      // Make a copy of the matching order before potentially erasing it
-      Order matched_order = level.orders.front();
-      uint32_t trade_quantity =
-          std::min(order.getQuantity(), matched_order.getQuantity());
+  void clear() {
+    for (auto &level : _levels) {
+      level = PriceLevel{level.price};
+    }
+    std::fill(_occupied.begin(), _occupied.end(), 0);
+    _best = NONE;
+  }
 
-      level.total_quantity -= trade_quantity;
+private:
+  static constexpr size_t NONE = static_cast<size_t>(-1);
 
-      if (matched_order.getQuantity() == trade_quantity) {
-        level.orders.erase(level.orders.begin());
-        if (level.orders.empty()) {
-          _pimpl->_bids.erase(bid_it);
+  size_t indexOf(Price price) const {
+    Price offset = price - _config.min_price;
+    if (offset < 0 || offset % _config.tick_size != 0) {
+      return NONE;
+    }
+    size_t i = static_cast<size_t>(offset / _config.tick_size);
+    return i < _levels.size() ? i : NONE;
+  }
+
+  // Scans from `from` towards worse prices for the next occupied level
+  size_t nextOccupied(size_t from) const {
+    if (_descending) {
+      size_t w = from / 64;
+      uint64_t bits = _occupied[w] & ((uint64_t{1} << (from % 64)) - 1);
+      while (true) {
+        if (bits) {
+          return w * 64 + 63 - std::countl_zero(bits);
+        }
+        if (w == 0) {
+          return NONE;
         }
+        bits = _occupied[--w];
       }
+    }
 
-      return matched_order;
+    size_t w = from / 64;
+    uint64_t bits =
+        from % 64 == 63 ? 0 : _occupied[w] & (~uint64_t{0} << (from % 64 + 1));
+    while (true) {
+      if (bits) {
+        return w * 64 + std::countr_zero(bits);
+      }
+      if (++w == _occupied.size()) {
+        return NONE;
+      }
+      bits = _occupied[w];
     }
   }
 
-  return std::nullopt;
-}
+  LadderConfig _config;
+  bool _descending;
+  std::pmr::vector<PriceLevel> _levels;
+  std::pmr::vector<uint64_t> _occupied;
+  size_t _best{NONE};
+};
+
+template <typename BidLevels, typename AskLevels>
+class OrderBook::Impl::Engine : public OrderBook::Impl {
+public:
+  // Both sides and the index allocate from the book's node pool
+  Engine() : _bids(&_nodes), _asks(&_nodes), _index(&_nodes) {}
+
+  explicit Engine(const LadderConfig &ladder)
+      : _bids(ladder, true, &_nodes), _asks(ladder, false, &_nodes),
+        _index(&_nodes) {}
+
+  ~Engine() override { clear(); }
+
+  MatchResult execute(const Order &order, std::span<Fill> fills, bool record,
+                      bool rest) override {
+    MatchResult result;
+    if (order.getLeavesQuantity() == 0 || (rest && !canRest(order))) {
+      return result; // Rejected before anything trades
+    }
+    result.accepted = true;
+
+    bool out_of_fills = order.getSide() == Side::BUY
+                            ? sweep(_asks, order, fills, record, result)
+                            : sweep(_bids, order, fills, record, result);
+
+    // A remainder left by a full fill buffer may still cross, so only rest
+    // once the opposing side no longer does
+    if (rest && result.remaining_quantity > 0 && !out_of_fills) {
+      if (order.getSide() == Side::BUY) {
+        restRemainder(_bids, order, result.remaining_quantity);
+      } else {
+        restRemainder(_asks, order, result.remaining_quantity);
+      }
+      result.rested = true;
+    }
+    return result;
+  }
 
-bool OrderBook::cancelOrder(uint64_t orderId) {
-  std::unique_lock<std::shared_mutex> lock(_pimpl->_book_mutex);
+  std::optional<Order> frontMatch(const Order &order) const override {
+    const PriceLevel *level =
+        order.getSide() == Side::BUY ? _asks.best() : _bids.best();
+    if (!level || !crosses(order, level->price)) {
+      return std::nullopt;
+    }
+    return *level->head;
+  }
 
-  auto remove_order = [](auto &orders, uint64_t id,
-                         double &total_quantity) -> bool {
-    auto it = std::find_if(orders.begin(), orders.end(),
-                           [id](const Order &o) { return o.getId() == id; });
+  bool cancelOrder(uint64_t orderId, uint32_t owner) override {
+    auto it = _index.find(orderId);
+    if (it == _index.end() || it->second.order->getOwner() != owner) {
+      return false;
+    }
 
-    if (it != orders.end()) {
-      total_quantity -= it->getQuantity();
-      orders.erase(it);
-      return true;
+    // Copy out the location, remove() invalidates the index entry
+    const OrderLocation location = it->second;
+    if (location.order->getSide() == Side::BUY) {
+      remove(_bids, *location.level, location.order);
+    } else {
+      remove(_asks, *location.level, location.order);
     }
-    return false;
+    return true;
+  }
+
+  MatchResult replaceOrder(uint64_t orderId, Side side, Price price,
+                           uint32_t quantity, std::span<Fill> fills,
+                           uint32_t owner) override {
+    MatchResult result;
+    auto it = _index.find(orderId);
+    if (it == _index.end() || quantity == 0) {
+      return result;
+    }
+    const OrderLocation location = it->second;
+    Order *order = location.order;
+    if (order->getSide() != side || order->getOwner() != owner) {
+      return result;
+    }
+
+    // A smaller size at the same price changes nothing ahead of the order
+    if (price == order->getPrice() && quantity <= order->_leaves_quantity) {
+      location.level->total_quantity -= order->_leaves_quantity - quantity;
+      order->_leaves_quantity = quantity;
+      result.accepted = true;
+      result.rested = true;
+      result.remaining_quantity = quantity;
+      return result;
+    }
+
+    if (side == Side::BUY ? !_bids.accepts(price) : !_asks.accepts(price)) {
+      return result;
+    }
+    if (side == Side::BUY) {
+      remove(_bids, *location.level, order);
+    } else {
+      remove(_asks, *location.level, order);
+    }
+    return execute(Order(orderId, side, price, quantity, owner), fills, true,
+                   true);
+  }
+
+  Price getBestBid() const override {
+    const PriceLevel *level = _bids.best();
+    return level ? level->price : 0;
+  }
+
+  Price getBestAsk() const override {
+    const PriceLevel *level = _asks.best();
+    return level ? level->price : 0;
+  }
+
+  uint64_t getBestBidSize() const override {
+    const PriceLevel *level = _bids.best();
+    return level ? level->total_quantity : 0;
+  }
+
+  uint64_t getBestAskSize() const override {
+    const PriceLevel *level = _asks.best();
+    return level ? level->total_quantity : 0;
+  }
+
+  uint64_t getDepth(Side side, Price price) const override {
+    const PriceLevel *level =
+        side == Side::BUY ? _bids.find(price) : _asks.find(price);
+    return level ? level->total_quantity : 0;
+  }
+
+  void clear() override {
+    release(_bids);
+    release(_asks);
+    _index.clear();
+  }
+
+private:
+  struct OrderLocation {
+    Order *order;
+    PriceLevel *level;
   };
 
-  for (auto &[price, level] : _pimpl->_bids) {
-    if (remove_order(level.orders, orderId, level.total_quantity)) {
-      if (level.orders.empty()) {
-        _pimpl->_bids.erase(price);
-      }
-      return true;
+  static bool crosses(const Order &order, Price level_price) {
+    return order.getSide() == Side::BUY ? level_price <= order.getPrice()
+                                        : level_price >= order.getPrice();
+  }
+
+  bool canRest(const Order &order) const {
+    if (_index.find(order.getId()) != _index.end()) {
+      return false; // Order ids must be unique among resting orders
     }
+    return order.getSide() == Side::BUY ? _bids.accepts(order.getPrice())
+                                        : _asks.accepts(order.getPrice());
   }
 
-  for (auto &[price, level] : _pimpl->_asks) {
-    if (remove_order(level.orders, orderId, level.total_quantity)) {
-      if (level.orders.empty()) {
-        _pimpl->_asks.erase(price);
+  // Walks the opposing side best level first, filling resting orders in time
+  // priority until the order is done or stops crossing. Returns true if it
+  // stopped early because the fill buffer is full.
+  template <typename Levels>
+  bool sweep(Levels &levels, const Order &order, std::span<Fill> fills,
+             bool record, MatchResult &result) {
+    uint32_t remaining = order.getLeavesQuantity();
+    bool out_of_fills = false;
+
+    while (remaining > 0) {
+      PriceLevel *level = levels.best();
+      if (!level || !crosses(order, level->price)) {
+        break;
       }
-      return true;
+      if (record && result.fill_count == fills.size()) {
+        out_of_fills = true;
+        break;
+      }
+
+      Order *maker = level->head;
+      uint32_t trade_quantity = std::min(remaining, maker->_leaves_quantity);
+      if (record) {
+        fills[result.fill_count] =
+            Fill{maker->getId(), order.getId(), level->price, trade_quantity};
+      }
+      result.fill_count++;
+      remaining -= trade_quantity;
+      maker->_leaves_quantity -= trade_quantity;
+      level->total_quantity -= trade_quantity;
+
+      if (maker->_leaves_quantity == 0) {
+        remove(levels, *level, maker);
+      }
+    }
+
+    result.filled_quantity = order.getLeavesQuantity() - remaining;
+    result.remaining_quantity = remaining;
+    return out_of_fills;
+  }
+
+  template <typename Levels>
+  void restRemainder(Levels &levels, const Order &order, uint32_t leaves) {
+    PriceLevel *level = levels.level(order.getPrice());
+    Order *node =
+        OrderAllocator::create(order.getId(), order.getSide(), order.getPrice(),
+                               order.getQuantity(), order.getOwner());
+    node->_leaves_quantity = leaves;
+    level->push(node);
+    _index.emplace(node->getId(), OrderLocation{node, level});
+  }
+
+  // Unlinks the order, returns its node to the allocator and drops the level
+  // once it is empty
+  template <typename Levels>
+  void remove(Levels &levels, PriceLevel &level, Order *order) {
+    level.unlink(order);
+    _index.erase(order->getId());
+    OrderAllocator::destroy(order);
+    if (!level.head) {
+      levels.erase(&level);
     }
   }
 
-  return false;
+  template <typename Levels> static void release(Levels &levels) {
+    levels.forEach([](PriceLevel &level) {
+      Order *order = level.head;
+      while (order) {
+        Order *next = order->_next;
+        OrderAllocator::destroy(order);
+        order = next;
+      }
+    });
+    levels.clear();
+  }
+
+  BidLevels _bids;
+  AskLevels _asks;
+  std::pmr::unordered_map<uint64_t, OrderLocation> _index; // id -> node
+};
+
+OrderBook::OrderBook(const PriceScale &scale, WriterMode mode)
+    : _pimpl(new Impl::Engine<Impl::MapLevels<std::greater<>>,
+                              Impl::MapLevels<std::less<>>>()) {
+  _pimpl->_scale = scale;
+  _pimpl->_mode = mode;
 }
 
-double OrderBook::getBestBid() const {
-  std::shared_lock<std::shared_mutex> lock(_pimpl->_book_mutex);
-  if (_pimpl->_bids.empty()) {
-    return 0.0;
+OrderBook::OrderBook(const LadderConfig &ladder, const PriceScale &scale,
+                     WriterMode mode)
+    : _pimpl(
+          new Impl::Engine<Impl::LadderLevels, Impl::LadderLevels>(ladder)) {
+  _pimpl->_scale = scale;
+  _pimpl->_mode = mode;
+}
+
+OrderBook::~OrderBook() { delete _pimpl; }
+
+bool OrderBook::addOrder(const Order &order) {
+  auto lock = _pimpl->writeLock();
+  bool accepted = _pimpl->execute(order, {}, false, true).accepted;
+  _pimpl->publishTopOfBook();
+  return accepted;
+}
+
+MatchResult OrderBook::addOrder(const Order &order, std::span<Fill> fills) {
+  auto lock = _pimpl->writeLock();
+  MatchResult result = _pimpl->execute(order, fills, true, true);
+  _pimpl->publishTopOfBook();
+  return result;
+}
+
+void OrderBook::clear() {
+  auto lock = _pimpl->writeLock();
+  _pimpl->clear();
+  _pimpl->publishTopOfBook();
+}
+
+std::optional<Order> OrderBook::matchOrder(const Order &order) {
+  auto lock = _pimpl->writeLock();
+  // Report the first resting order hit, as it was before the sweep
+  auto matched_order = _pimpl->frontMatch(order);
+  if (matched_order) {
+    _pimpl->execute(order, {}, false, false);
+    _pimpl->publishTopOfBook();
   }
-  return _pimpl->_bids.begin()->first;
+  return matched_order;
+}
+
+MatchResult OrderBook::matchOrder(const Order &order, std::span<Fill> fills) {
+  auto lock = _pimpl->writeLock();
+  MatchResult result = _pimpl->execute(order, fills, true, false);
+  _pimpl->publishTopOfBook();
+  return result;
 }
 
-double OrderBook::getBestAsk() const {
-  std::shared_lock<std::shared_mutex> lock(_pimpl->_book_mutex);
-  if (_pimpl->_asks.empty()) {
-    return 0.0;
+bool OrderBook::cancelOrder(uint64_t orderId, uint32_t owner) {
+  auto lock = _pimpl->writeLock();
+  bool cancelled = _pimpl->cancelOrder(orderId, owner);
+  _pimpl->publishTopOfBook();
+  return cancelled;
+}
+
+MatchResult OrderBook::replaceOrder(uint64_t orderId, Side side, Price price,
+                                   uint32_t quantity, std::span<Fill> fills,
+                                   uint32_t owner) {
+  auto lock = _pimpl->writeLock();
+  MatchResult result =
+      _pimpl->replaceOrder(orderId, side, price, quantity, fills, owner);
+  _pimpl->publishTopOfBook();
+  return result;
+}
+
+void OrderBook::post(const BookCommand &command) {
+  _pimpl->_commands.push(command);
+}
+
+size_t OrderBook::drain(const BookCommandHandler &handler) {
+  size_t applied = 0;
+  BookCommand command;
+  while (_pimpl->_commands.tryPop(command)) {
+    MatchResult result;
+    if (command.type == BookCommandType::CANCEL) {
+      result.accepted = cancelOrder(command.order_id, command.owner);
+    } else {
+      Order order(command.order_id, command.side, command.price,
+                  command.quantity, command.owner);
+      auto lock = _pimpl->writeLock();
+      result = _pimpl->execute(order, {}, false,
+                               command.type == BookCommandType::ADD);
+      _pimpl->publishTopOfBook();
+    }
+    if (handler) {
+      handler(command, result);
+    }
+    applied++;
   }
-  return _pimpl->_asks.begin()->first;
+  return applied;
+}
+
+TopOfBook OrderBook::getTopOfBook() const { return _pimpl->readTopOfBook(); }
+
+Price OrderBook::getBestBid() const {
+  return _pimpl->readTopOfBook().best_bid;
 }
 
+Price OrderBook::getBestAsk() const {
+  return _pimpl->readTopOfBook().best_ask;
+}
+
+uint64_t OrderBook::getBestBidSize() const {
+  return _pimpl->readTopOfBook().bid_size;
+}
+
+uint64_t OrderBook::getBestAskSize() const {
+  return _pimpl->readTopOfBook().ask_size;
+}
+
+uint64_t OrderBook::getDepth(Side side, Price price) const {
+  auto lock = _pimpl->readLock();
+  return _pimpl->getDepth(side, price);
+}
+
+WriterMode OrderBook::getWriterMode() const { return _pimpl->_mode; }
+
+const PriceScale &OrderBook::getPriceScale() const { return _pimpl->_scale; }
+
 } // namespace orderbook
@@ -1,9 +1,13 @@
 #include "../../include/session/session.hpp"
+#include "../../include/network/thread_pool.hpp"
 
 namespace session {
 
-Session::Session(const std::string &session_id)
-    : _session_id(session_id), _active(true) {}
+Session::Session(const std::string &session_id,
+                 std::shared_ptr<network::ThreadPool> executor,
+                 ShardPlacer placer)
+    : _session_id(session_id), _executor(std::move(executor)),
+      _placer(std::move(placer)), _active(true) {}
 
 Session::~Session() = default;
 
@@ -15,8 +19,12 @@ bool Session::addUser(const std::string &username, int socket_fd) {
     return false;
   }
 
+  // A username keeps its owner id across leaving and joining again, so its
+  // resting orders stay reachable. Ids start at 1, 0 means unowned.
+  auto owner = _owner_ids.try_emplace(username, _owner_ids.size() + 1).first;
+
   // Create new user and add to maps
-  auto user = std::make_shared<User>(username, socket_fd);
+  auto user = std::make_shared<User>(username, socket_fd, owner->second);
   _users[username] = user;
   _socket_to_username[socket_fd] = username;
 
@@ -87,12 +95,39 @@ size_t Session::getUserCount() const {
 
 bool Session::isActive() const { return _active; }
 
-void Session::createOrderBook(const std::string &symbol) {
+network::ThreadPool *Session::getExecutor() const { return _executor.get(); }
+
+void Session::createOrderBook(const std::string &symbol,
+                              const orderbook::PriceScale &scale) {
   std::lock_guard<std::mutex> lock(_mutex);
 
   if (_orderbooks.find(symbol) == _orderbooks.end()) {
-    _orderbooks[symbol] = std::make_unique<orderbook::OrderBook>();
+    _orderbooks[symbol] = std::make_unique<orderbook::OrderBook>(scale);
+    listBook(symbol);
+  }
+}
+
+void Session::createOrderBook(const std::string &symbol,
+                              const orderbook::LadderConfig &ladder,
+                              const orderbook::PriceScale &scale) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  if (_orderbooks.find(symbol) == _orderbooks.end()) {
+    _orderbooks[symbol] =
+        std::make_unique<orderbook::OrderBook>(ladder, scale);
+    listBook(symbol);
+  }
+}
+
+// Called with _mutex held. Past MAX_SYMBOLS a book is only reachable by name.
+void Session::listBook(const std::string &symbol) {
+  if (_listings.size() >= MAX_SYMBOLS) {
+    return;
   }
+  size_t shard = _placer ? _placer(_session_id, symbol) : 0;
+  _listings.push_back(std::make_unique<Listing>(
+      Listing{symbol, _orderbooks[symbol].get(), shard}));
+  _listing_refs.add(_listings.back().get());
 }
 
 orderbook::OrderBook *Session::getOrderBook(const std::string &symbol) {
@@ -118,4 +153,28 @@ std::vector<std::string> Session::getAvailableSymbols() const {
   return symbols;
 }
 
+uint32_t Session::getSymbolRef(const std::string &symbol) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (size_t ref = 0; ref < _listings.size(); ++ref) {
+    if (_listings[ref]->symbol == symbol) {
+      return static_cast<uint32_t>(ref);
+    }
+  }
+  return decltype(_listing_refs)::NO_REF;
+}
+
+const Session::Listing *Session::getListing(uint32_t symbol_ref) const {
+  return _listing_refs.find(symbol_ref);
+}
+
+std::vector<std::pair<std::string, uint32_t>> Session::getSymbolRefs() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::vector<std::pair<std::string, uint32_t>> refs;
+  refs.reserve(_listings.size());
+  for (size_t ref = 0; ref < _listings.size(); ++ref) {
+    refs.emplace_back(_listings[ref]->symbol, static_cast<uint32_t>(ref));
+  }
+  return refs;
+}
+
 } // namespace session
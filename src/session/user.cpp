@@ -2,8 +2,9 @@
 
 namespace session {
 
-User::User(std::string username, int socket_fd)
+User::User(std::string username, int socket_fd, uint32_t owner_id)
     : _username(std::move(username)), _socket_fd(socket_fd),
+      _owner_id(owner_id),
       _balance(10000.0), // Starting balance, can be made configurable
       _active(true) {}
 
@@ -13,6 +14,8 @@ const std::string &User::getUsername() const { return _username; }
 
 int User::getSocketFd() const { return _socket_fd; }
 
+uint32_t User::getOwnerId() const { return _owner_id; }
+
 double User::getBalance() const { return _balance; }
 
 void User::updateBalance(double amount) { _balance += amount; }
@@ -1,6 +1,15 @@
+#include "../include/network/ring_queue.hpp"
+#include "../include/network/sharded_engine.hpp"
+#include "../include/network/task_queue.hpp"
+#include "../include/network/thread_pool.hpp"
+#include "../include/network/work_stealing_deque.hpp"
+#include "../include/network/work_stealing_pool.hpp"
 #include "../include/orderbook/order_allocator.hpp"
 #include "../include/orderbook/orderbook.hpp"
 #include "../include/session/session.hpp"
+#include "support/allocation_counter.hpp"
+#include <array>
+#include <atomic>
 #include <future>
 #include <gtest/gtest.h>
 #include <random>
@@ -33,7 +42,8 @@ protected:
     static std::uniform_real_distribution<> price_dist(price_min, price_max);
     static std::uniform_int_distribution<> qty_dist(qty_min, qty_max);
 
-    return OrderAllocator::create(++next_id, side, price_dist(gen),
+    return OrderAllocator::create(++next_id, side,
+                                  PriceScale{}.toTicks(price_dist(gen)),
                                   qty_dist(gen));
   }
 
@@ -89,10 +99,10 @@ TEST_F(ConcurrentOrderBookTest, ConcurrentOrderAddition) {
   }
 
   // Verify no price inversions
-  double last_bid = book.getBestBid();
-  double last_ask = book.getBestAsk();
-  EXPECT_GT(last_bid, 0.0);
-  EXPECT_GT(last_ask, 0.0);
+  Price last_bid = book.getBestBid();
+  Price last_ask = book.getBestAsk();
+  EXPECT_GT(last_bid, 0);
+  EXPECT_GT(last_ask, 0);
   EXPECT_GE(last_ask, last_bid);
 
   // Cleanup
@@ -212,3 +222,412 @@ TEST_F(ConcurrentOrderBookTest, ConsistencyUnderLoad) {
   // Verify total number of orders processed
   EXPECT_EQ(matched_orders + unmatched_orders, num_orders * 2);
 }
+
+TEST_F(ConcurrentOrderBookTest, SingleWriterDrainsPostedOrders) {
+  const size_t orders_per_producer = 2000;
+  const int num_producers = 4;
+  const size_t total = orders_per_producer * num_producers;
+  OrderBook owned({}, WriterMode::SINGLE_WRITER);
+
+  std::atomic<bool> done{false};
+  std::atomic<size_t> crossed_snapshots{0};
+  std::atomic<size_t> next_order_id{0};
+
+  // Readers poll the top of book while the owner mutates it
+  std::thread reader([&]() {
+    while (!done.load(std::memory_order_acquire)) {
+      TopOfBook top = owned.getTopOfBook();
+      if (top.best_bid != 0 && top.best_ask != 0 &&
+          top.best_bid >= top.best_ask) {
+        crossed_snapshots++;
+      }
+    }
+  });
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&, p]() {
+      std::mt19937 gen(p);
+      std::uniform_int_distribution<Price> price_dist(95, 105);
+      for (size_t i = 0; i < orders_per_producer; ++i) {
+        Side side = (i % 2 == 0) ? Side::BUY : Side::SELL;
+        owned.post(BookCommand{BookCommandType::ADD, ++next_order_id, side,
+                               PriceScale{}.toTicks(price_dist(gen)), 10});
+      }
+    });
+  }
+
+  size_t applied = 0;
+  size_t accepted = 0;
+  while (applied < total) {
+    applied += owned.drain(
+        [&](const BookCommand &, const MatchResult &result) {
+          accepted += result.accepted;
+        });
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  done.store(true, std::memory_order_release);
+  reader.join();
+
+  EXPECT_EQ(applied, total);
+  EXPECT_EQ(accepted, total);
+  EXPECT_EQ(crossed_snapshots, 0);
+  TopOfBook top = owned.getTopOfBook();
+  EXPECT_EQ(top.best_bid, owned.getBestBid());
+  EXPECT_EQ(top.bid_size, owned.getDepth(Side::BUY, top.best_bid));
+  owned.clear();
+}
+
+TEST(RingQueueTest, DeliversEveryItemOnceAcrossProducers) {
+  const int num_producers = 4;
+  const uint64_t items_per_producer = 20000;
+  network::RingQueue<uint64_t> ring(1000);
+  EXPECT_EQ(ring.getCapacity(), 1024);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&ring, p, items_per_producer]() {
+      for (uint64_t i = 0; i < items_per_producer; ++i) {
+        while (!ring.tryPush(p * items_per_producer + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Items from one producer must come out in the order it pushed them
+  std::vector<uint64_t> last_seen(num_producers, 0);
+  std::vector<uint64_t> counts(num_producers, 0);
+  uint64_t item;
+  for (uint64_t received = 0; received < num_producers * items_per_producer;) {
+    if (!ring.tryPop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    size_t producer = item / items_per_producer;
+    uint64_t sequence = item % items_per_producer;
+    if (counts[producer] > 0) {
+      EXPECT_GT(sequence, last_seen[producer]);
+    }
+    last_seen[producer] = sequence;
+    counts[producer]++;
+    received++;
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  for (uint64_t count : counts) {
+    EXPECT_EQ(count, items_per_producer);
+  }
+  EXPECT_FALSE(ring.tryPop(item));
+
+  // push() waits for room instead of failing
+  for (uint64_t i = 0; i < ring.getCapacity(); ++i) {
+    ring.push(i);
+  }
+  EXPECT_EQ(ring.getSize(), ring.getCapacity());
+  EXPECT_FALSE(ring.tryPush(0));
+  ring.clear();
+  EXPECT_TRUE(ring.isEmpty());
+}
+
+TEST(TaskQueueTest, DeliversEveryItemOnceAcrossSegments) {
+  constexpr int NUM_PRODUCERS = 4;
+  constexpr int NUM_CONSUMERS = 4;
+  constexpr int ITEMS_PER_PRODUCER = 25000;
+  constexpr int TOTAL = NUM_PRODUCERS * ITEMS_PER_PRODUCER;
+  // Small segments, so producers and consumers keep crossing into new ones
+  network::TaskQueue<int, 16> queue;
+  std::vector<std::atomic<int>> seen(TOTAL);
+  std::atomic<int> received{0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < NUM_PRODUCERS; ++p) {
+    threads.emplace_back([&queue, p]() {
+      for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+        if (i % 2) {
+          queue.push(p * ITEMS_PER_PRODUCER + i);
+        } else {
+          queue.emplace(p * ITEMS_PER_PRODUCER + i);
+        }
+      }
+    });
+  }
+  for (int c = 0; c < NUM_CONSUMERS; ++c) {
+    threads.emplace_back([&]() {
+      int item;
+      while (received.load() < TOTAL) {
+        if (queue.tryPop(item)) {
+          seen[item]++;
+          received++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (auto &count : seen) {
+    EXPECT_EQ(count.load(), 1);
+  }
+  EXPECT_TRUE(queue.isEmpty());
+
+  queue.push(1);
+  queue.push(2);
+  EXPECT_EQ(queue.getSize(), 2u);
+  queue.clear();
+  EXPECT_EQ(queue.getSize(), 0u);
+}
+
+TEST(ShardedEngineTest, RunsEachBookOnOneThreadInPostOrder) {
+  network::ShardedEngine engine(4, 64);
+  const std::vector<std::string> symbols = {"AAA", "BBB", "CCC", "DDD", "EEE"};
+  const int tasks_per_symbol = 500;
+
+  // The same key always lands on the same shard
+  for (const auto &symbol : symbols) {
+    EXPECT_EQ(engine.shardFor("default", symbol),
+              engine.shardFor("default", symbol));
+    EXPECT_LT(engine.shardFor("default", symbol), engine.getShardCount());
+  }
+
+  std::vector<std::vector<int>> executed(symbols.size());
+  std::vector<std::thread::id> owner(symbols.size());
+  std::atomic<size_t> wrong_thread{0};
+
+  std::vector<std::thread> clients;
+  for (size_t s = 0; s < symbols.size(); ++s) {
+    clients.emplace_back([&, s]() {
+      size_t shard = engine.shardFor("default", symbols[s]);
+      for (int i = 0; i < tasks_per_symbol; ++i) {
+        engine.post(shard, [&, s, i]() {
+          if (executed[s].empty()) {
+            owner[s] = std::this_thread::get_id();
+          } else if (owner[s] != std::this_thread::get_id()) {
+            wrong_thread++;
+          }
+          executed[s].push_back(i);
+        });
+      }
+    });
+  }
+
+  for (auto &client : clients) {
+    client.join();
+  }
+  engine.stop();
+  EXPECT_FALSE(engine.tryPost(0, []() {}));
+
+  EXPECT_EQ(wrong_thread, 0);
+  for (const auto &sequence : executed) {
+    ASSERT_EQ(sequence.size(), static_cast<size_t>(tasks_per_symbol));
+    for (int i = 0; i < tasks_per_symbol; ++i) {
+      EXPECT_EQ(sequence[i], i);
+    }
+  }
+}
+
+TEST(WorkStealingDequeTest, EveryItemIsTakenExactlyOnce) {
+  constexpr int NUM_ITEMS = 100000;
+  constexpr int NUM_THIEVES = 3;
+  network::WorkStealingDeque<int> deque(4); // small, so it has to grow
+  std::vector<int> items(NUM_ITEMS);
+  std::vector<std::atomic<int>> taken(NUM_ITEMS);
+  std::atomic<bool> done{false};
+
+  auto take = [&](int *item) { taken[item - items.data()]++; };
+
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < NUM_THIEVES; ++t) {
+    thieves.emplace_back([&]() {
+      while (!done.load() || !deque.isEmpty()) {
+        if (int *item = deque.steal()) {
+          take(item);
+        }
+      }
+    });
+  }
+
+  // The owner pops some of its own work back while thieves take the rest
+  for (int i = 0; i < NUM_ITEMS; ++i) {
+    deque.push(&items[i]);
+    if (i % 3 == 0) {
+      if (int *item = deque.pop()) {
+        take(item);
+      }
+    }
+  }
+  while (int *item = deque.pop()) {
+    take(item);
+  }
+  done.store(true);
+  for (auto &thief : thieves) {
+    thief.join();
+  }
+
+  for (auto &count : taken) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+TEST(WorkStealingPoolTest, RunsExternalAndNestedTasks) {
+  constexpr int NUM_ROOTS = 16;
+  constexpr int CHILDREN = 500;
+  network::WorkStealingPool pool;
+  pool.init(4);
+  EXPECT_TRUE(pool.isRunning());
+  EXPECT_EQ(pool.getSize(), 4u);
+
+  std::atomic<int> children{0};
+  std::vector<std::future<int>> roots;
+  for (int r = 0; r < NUM_ROOTS; ++r) {
+    roots.push_back(pool.async(
+        [&](int root) {
+          // Submitted from a worker, so these land on its own deque
+          for (int i = 0; i < CHILDREN; ++i) {
+            pool.async([&]() { children++; });
+          }
+          return root;
+        },
+        r));
+  }
+  for (int r = 0; r < NUM_ROOTS; ++r) {
+    EXPECT_EQ(roots[r].get(), r);
+  }
+
+  // terminate() runs everything still queued before returning
+  pool.terminate();
+  EXPECT_EQ(children.load(), NUM_ROOTS * CHILDREN);
+  EXPECT_FALSE(pool.isRunning());
+  EXPECT_THROW(pool.async([]() {}), std::runtime_error);
+}
+
+// Once nodes are recycled, fire-and-forget submits allocate nothing
+TEST(WorkStealingPoolTest, SubmitReusesTaskNodes) {
+  constexpr int TASKS = 1000;
+  network::WorkStealingPool pool;
+  pool.init(2);
+  std::atomic<int> done{0};
+
+  auto runBatch = [&](int tasks) {
+    done = 0;
+    for (int i = 0; i < tasks; ++i) {
+      pool.submit([&done]() { done++; });
+    }
+    while (done.load() < tasks) {
+      std::this_thread::yield();
+    }
+  };
+  runBatch(TASKS);
+
+  // Half as many, so nodes still on their way back cannot run the pool dry
+  allocations::counting_thread = true;
+  allocations::thread_count = 0;
+  runBatch(TASKS / 2);
+  allocations::counting_thread = false;
+  EXPECT_EQ(allocations::thread_count, 0u);
+}
+
+TEST(ThreadPoolTest, SubmitRunsMoveOnlyAndLargeTasks) {
+  network::ThreadPool pool;
+  pool.init(2);
+  std::promise<int> small_done;
+  std::promise<int> large_done;
+
+  // Move-only capture, fits inline
+  auto value = std::make_unique<int>(7);
+  pool.submit([value = std::move(value), &small_done]() {
+    small_done.set_value(*value);
+  });
+
+  // Too big to store inline, goes to the heap instead
+  std::array<int, 64> payload{};
+  payload.back() = 11;
+  pool.submit(
+      [payload, &large_done]() { large_done.set_value(payload.back()); });
+
+  EXPECT_EQ(small_done.get_future().get(), 7);
+  EXPECT_EQ(large_done.get_future().get(), 11);
+  pool.terminate();
+  EXPECT_THROW(pool.submit([]() {}), std::runtime_error);
+}
+
+// Symbol refs resolve without the session lock while books are still being
+// listed, and a ref is never seen before its listing is complete
+TEST(SessionTest, ResolvesSymbolRefsWhileBooksAreListed) {
+  Session session("refs");
+  const uint32_t books = 200;
+  std::vector<std::string> symbols;
+  for (uint32_t i = 0; i < books; ++i) {
+    symbols.push_back(std::string("S").append(std::to_string(i)));
+  }
+  std::atomic<bool> done{false};
+  std::atomic<size_t> torn{0};
+
+  std::thread reader([&]() {
+    while (!done.load()) {
+      for (uint32_t ref = 0; ref < books; ++ref) {
+        const auto *listing = session.getListing(ref);
+        if (listing && (!listing->book || listing->symbol != symbols[ref])) {
+          torn++;
+        }
+      }
+    }
+  });
+
+  for (uint32_t i = 0; i < books; ++i) {
+    session.createOrderBook(symbols[i]);
+  }
+  done = true;
+  reader.join();
+
+  EXPECT_EQ(torn, 0u);
+  EXPECT_EQ(session.getSymbolRefs().size(), books);
+  EXPECT_EQ(session.getSymbolRef("S42"), 42u);
+  EXPECT_EQ(session.getListing(42)->book, session.getOrderBook("S42"));
+  EXPECT_EQ(session.getSymbolRef("missing"), (InternTable<int, 1>::NO_REF));
+  EXPECT_EQ(session.getListing(books), nullptr);
+}
+
+// Each book is placed on a shard once, when it is listed
+TEST(SessionTest, PlacesEachListingOnItsShard) {
+  network::ShardedEngine engine(3);
+  size_t placed = 0;
+  Session session("placed", nullptr,
+                  [&](const std::string &id, const std::string &symbol) {
+                    ++placed;
+                    return engine.shardFor(id, symbol);
+                  });
+  session.createOrderBook("A");
+  session.createOrderBook("B");
+  session.createOrderBook("A");
+
+  EXPECT_EQ(placed, 2u);
+  EXPECT_EQ(session.getListing(0)->shard, engine.shardFor("placed", "A"));
+  EXPECT_EQ(session.getListing(1)->shard, engine.shardFor("placed", "B"));
+
+  Session unplaced("unplaced");
+  unplaced.createOrderBook("A");
+  EXPECT_EQ(unplaced.getListing(0)->shard, 0u);
+}
+
+// A username keeps its owner id when it leaves and joins again
+TEST(SessionTest, KeepsOwnerIdsAcrossRejoins) {
+  Session session("owners");
+  ASSERT_TRUE(session.addUser("maker", 3));
+  ASSERT_TRUE(session.addUser("taker", 4));
+  uint32_t maker = session.getUser("maker")->getOwnerId();
+  EXPECT_NE(maker, 0u);
+  EXPECT_NE(session.getUser("taker")->getOwnerId(), maker);
+
+  ASSERT_TRUE(session.removeUserBySocket(3));
+  ASSERT_TRUE(session.addUser("maker", 5));
+  EXPECT_EQ(session.getUser("maker")->getOwnerId(), maker);
+}
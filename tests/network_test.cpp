@@ -1,14 +1,19 @@
+#include "../include/network/protocol.hpp"
 #include "../include/network/server.hpp"
 #include "../include/session/session.hpp"
 #include <arpa/inet.h>
+#include <cstring>
+#include <algorithm>
 #include <future>
 #include <gtest/gtest.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <nlohmann/json.hpp>
+#include <sstream>
 #include <sys/socket.h>
 #include <thread>
 #include <unistd.h>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
@@ -47,7 +52,8 @@ protected:
 
   // Helper to send message and get response
   std::string sendMessage(int sock, const std::string &message) {
-    if (send(sock, message.c_str(), message.length(), 0) < 0) {
+    std::string line = message + "\n";
+    if (send(sock, line.c_str(), line.length(), 0) < 0) {
       throw std::runtime_error("Failed to send message");
     }
 
@@ -71,6 +77,84 @@ protected:
     return responseJson["status"] == "success";
   }
 
+  // Restarts the fixture's server with another protocol or backend
+  void restartServer(bool use_binary_protocol, network::IoBackendType backend) {
+    server = std::make_unique<network::NetworkServer>(
+        test_port, use_binary_protocol, backend);
+    server->createSession("test_session");
+    server->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  // Layout of the server's binary order ack
+  struct OrderAck {
+    network::MessageHeader header;
+    uint64_t order_id;
+    uint8_t success;
+    char message[256];
+  };
+
+  OrderAck readOrderAck(int sock) {
+    OrderAck ack{};
+    if (recv(sock, &ack, sizeof(ack), MSG_WAITALL) != sizeof(ack)) {
+      throw std::runtime_error("Failed to receive order ack");
+    }
+    return ack;
+  }
+
+  // Reads a JOIN_ACK and its symbol refs, by symbol
+  std::unordered_map<std::string, uint32_t>
+  readJoinAck(int sock, network::JoinAckMessage &ack) {
+    using network::BinaryProtocol;
+    if (recv(sock, &ack, sizeof(ack), MSG_WAITALL) != sizeof(ack)) {
+      throw std::runtime_error("Failed to receive join ack");
+    }
+    std::unordered_map<std::string, uint32_t> symbol_refs;
+    for (uint16_t i = 0; i < BinaryProtocol::ntoh16(ack.symbol_count); ++i) {
+      network::SymbolRef ref;
+      if (recv(sock, &ref, sizeof(ref), MSG_WAITALL) != sizeof(ref)) {
+        throw std::runtime_error("Failed to receive symbol ref");
+      }
+      symbol_refs[std::string(ref.symbol, strnlen(ref.symbol, 8))] =
+          BinaryProtocol::ntoh32(ref.symbol_ref);
+    }
+    return symbol_refs;
+  }
+
+  // Sends a join and two orders in one write, the last frame split across
+  // two, and checks each order is acked
+  void expectPipelinedFramesDecoded() {
+    using network::BinaryProtocol;
+    std::vector<uint8_t> stream =
+        BinaryProtocol::serializeJoin("trader1", "test_session");
+    for (uint64_t order_id : {1, 2}) {
+      auto order = BinaryProtocol::serializeNewOrder(order_id, true, 100, 1,
+                                                     "STOCK", "test_session");
+      stream.insert(stream.end(), order.begin(), order.end());
+    }
+
+    int sock = createClientSocket();
+    size_t split = stream.size() - 10;
+    ASSERT_EQ(send(sock, stream.data(), split, 0), static_cast<ssize_t>(split));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(send(sock, stream.data() + split, stream.size() - split, 0), 10);
+
+    // Join ack, then one ack per order
+    network::JoinAckMessage join_ack;
+    auto symbol_refs = readJoinAck(sock, join_ack);
+    EXPECT_EQ(join_ack.header.type, network::MessageType::JOIN_ACK);
+    EXPECT_EQ(join_ack.success, 1);
+    EXPECT_EQ(symbol_refs.count("STOCK"), 1u);
+
+    for (uint64_t i = 0; i < 2; ++i) {
+      OrderAck ack = readOrderAck(sock);
+      EXPECT_EQ(ack.header.type, network::MessageType::ORDER_ACK);
+      EXPECT_EQ(BinaryProtocol::ntoh64(ack.order_id), i + 1);
+      EXPECT_EQ(ack.success, 1);
+    }
+    close(sock);
+  }
+
   std::unique_ptr<network::NetworkServer> server;
   const uint16_t test_port = 8081;
 };
@@ -359,3 +443,619 @@ TEST_F(NetworkTest, HandlesMultipleClients) {
     }
   }
 }
+
+// Far more connections than event loop threads, each served in turn
+TEST_F(NetworkTest, ServesManyConcurrentConnections) {
+  constexpr int NUM_CLIENTS = 200;
+  server->start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::vector<int> sockets;
+  for (int i = 0; i < NUM_CLIENTS; ++i) {
+    sockets.push_back(createClientSocket());
+  }
+  for (int i = 0; i < NUM_CLIENTS; ++i) {
+    EXPECT_TRUE(joinSession(sockets[i], "trader" + std::to_string(i)));
+  }
+
+  json orderMsg = {{"type", "new_order"}, {"session_id", "test_session"},
+                   {"side", "buy"},       {"price", 100.0},
+                   {"quantity", 1},       {"order_id", 1}};
+  json response = json::parse(sendMessage(sockets.back(), orderMsg.dump()));
+  EXPECT_EQ(response["status"], "success");
+
+  for (int sock : sockets) {
+    close(sock);
+  }
+}
+
+// The blocking fallback backend serves the same protocol
+TEST_F(NetworkTest, ThreadBackendServesClients) {
+  restartServer(false, network::IoBackendType::THREADS);
+
+  int socket1 = createClientSocket();
+  int socket2 = createClientSocket();
+  EXPECT_TRUE(joinSession(socket1, "trader1"));
+  EXPECT_FALSE(joinSession(socket2, "trader1"));
+  close(socket1);
+  close(socket2);
+}
+
+// Several binary frames in one write, the last split across two
+TEST_F(NetworkTest, DecodesPipelinedBinaryFrames) {
+  restartServer(true, network::IoBackend::defaultType());
+  expectPipelinedFramesDecoded();
+}
+
+// The io_uring backend serves both protocols where the kernel supports it
+TEST_F(NetworkTest, UringBackendServesClients) {
+  try {
+    restartServer(false, network::IoBackendType::IO_URING);
+  } catch (const std::runtime_error &e) {
+    GTEST_SKIP() << e.what();
+  }
+
+  int socket1 = createClientSocket();
+  int socket2 = createClientSocket();
+  EXPECT_TRUE(joinSession(socket1, "trader1"));
+  EXPECT_FALSE(joinSession(socket2, "trader1"));
+
+  json orderMsg = {{"type", "new_order"}, {"session_id", "test_session"},
+                   {"side", "buy"},       {"price", 100.0},
+                   {"quantity", 10},      {"order_id", 1}};
+  json response = json::parse(sendMessage(socket1, orderMsg.dump()));
+  EXPECT_EQ(response["status"], "success");
+  close(socket1);
+  close(socket2);
+
+  restartServer(true, network::IoBackendType::IO_URING);
+  expectPipelinedFramesDecoded();
+}
+
+// A join and three orders in one write, the last split mid-line, each
+// answered with its own reply line
+TEST_F(NetworkTest, PipelinesJsonRequests) {
+  server->start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::string stream =
+      json{{"type", "join"}, {"username", "trader1"},
+           {"session_id", "test_session"}}.dump() + "\n";
+  for (int order_id = 1; order_id <= 3; ++order_id) {
+    stream += json{{"type", "new_order"}, {"session_id", "test_session"},
+                   {"side", "buy"},       {"price", 100.0},
+                   {"quantity", 1},       {"order_id", order_id}}
+                  .dump() +
+              "\n";
+  }
+
+  int sock = createClientSocket();
+  size_t split = stream.size() - 12;
+  ASSERT_EQ(send(sock, stream.data(), split, 0), static_cast<ssize_t>(split));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_EQ(send(sock, stream.data() + split, stream.size() - split, 0), 12);
+
+  std::string replies;
+  std::array<char, 4096> buffer;
+  while (std::count(replies.begin(), replies.end(), '\n') < 4) {
+    ssize_t bytes = recv(sock, buffer.data(), buffer.size(), 0);
+    ASSERT_GT(bytes, 0);
+    replies.append(buffer.data(), bytes);
+  }
+
+  std::istringstream lines(replies);
+  std::string line;
+  std::getline(lines, line);
+  EXPECT_EQ(json::parse(line)["status"], "success");
+  for (int order_id = 1; order_id <= 3; ++order_id) {
+    std::getline(lines, line);
+    json reply = json::parse(line);
+    EXPECT_EQ(reply["status"], "success");
+    EXPECT_EQ(reply["order_id"], order_id);
+  }
+  close(sock);
+}
+
+// Orders addressed by the refs handed out at JOIN, and a ref the server
+// never issued
+TEST_F(NetworkTest, PlacesOrdersByInternedRefs) {
+  using network::BinaryProtocol;
+  restartServer(true, network::IoBackend::defaultType());
+
+  int sock = createClientSocket();
+  auto join = BinaryProtocol::serializeJoin("trader1", "test_session");
+  ASSERT_EQ(send(sock, join.data(), join.size(), 0),
+            static_cast<ssize_t>(join.size()));
+
+  network::JoinAckMessage join_ack;
+  auto symbol_refs = readJoinAck(sock, join_ack);
+  ASSERT_EQ(join_ack.success, 1);
+  ASSERT_EQ(symbol_refs.count("STOCK"), 1u);
+  uint32_t session_ref = BinaryProtocol::ntoh32(join_ack.session_ref);
+
+  for (uint64_t order_id : {1, 2}) {
+    auto order = BinaryProtocol::serializeNewOrderRef(
+        order_id, true, 100, 1, session_ref, symbol_refs["STOCK"]);
+    ASSERT_EQ(send(sock, order.data(), order.size(), 0),
+              static_cast<ssize_t>(order.size()));
+    OrderAck ack = readOrderAck(sock);
+    EXPECT_EQ(BinaryProtocol::ntoh64(ack.order_id), order_id);
+    EXPECT_EQ(ack.success, 1);
+    EXPECT_STREQ(ack.message, "Order added to book");
+  }
+
+  auto unknown = BinaryProtocol::serializeNewOrderRef(3, true, 100, 1,
+                                                      session_ref, 999);
+  ASSERT_EQ(send(sock, unknown.data(), unknown.size(), 0),
+            static_cast<ssize_t>(unknown.size()));
+  struct ErrorAck {
+    network::MessageHeader header;
+    char message[256];
+  } error{};
+  ASSERT_EQ(recv(sock, &error, sizeof(error), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(error)));
+  EXPECT_STREQ(error.message, "Symbol not found");
+
+  // A session that does not exist is refused with an empty ack
+  int other = createClientSocket();
+  join = BinaryProtocol::serializeJoin("trader2", "no_such_session");
+  ASSERT_EQ(send(other, join.data(), join.size(), 0),
+            static_cast<ssize_t>(join.size()));
+  EXPECT_TRUE(readJoinAck(other, join_ack).empty());
+  EXPECT_EQ(join_ack.success, 0);
+
+  close(sock);
+  close(other);
+}
+
+// A batch across two books answered by one ack frame, each order with its
+// own outcome in the order sent
+TEST_F(NetworkTest, AcksOrderBatchInOneFrame) {
+  using network::BatchAckStatus;
+  using network::BinaryProtocol;
+  restartServer(true, network::IoBackend::defaultType());
+  server->getSession("test_session")->createOrderBook("OTHER");
+
+  int sock = createClientSocket();
+  auto join = BinaryProtocol::serializeJoin("trader1", "test_session");
+  ASSERT_EQ(send(sock, join.data(), join.size(), 0),
+            static_cast<ssize_t>(join.size()));
+  network::JoinAckMessage join_ack;
+  auto symbol_refs = readJoinAck(sock, join_ack);
+  ASSERT_EQ(symbol_refs.size(), 2u);
+
+  uint32_t stock = symbol_refs["STOCK"];
+  uint32_t other = symbol_refs["OTHER"];
+  std::vector<network::BatchOrder> orders = {
+      {1, 0, 100, 2, stock}, // rests
+      {2, 1, 100, 1, stock}, // nothing to sell yet
+      {3, 0, 50, 1, other},  // rests on the second book
+      {4, 0, 100, 1, 999},   // never issued
+      {5, 0, 101, 1, stock}, // rests above the first
+  };
+  auto batch = BinaryProtocol::serializeNewOrderBatch(
+      BinaryProtocol::ntoh32(join_ack.session_ref), orders);
+  ASSERT_EQ(send(sock, batch.data(), batch.size(), 0),
+            static_cast<ssize_t>(batch.size()));
+
+  network::OrderAckBatchMessage header;
+  ASSERT_EQ(recv(sock, &header, sizeof(header), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(header)));
+  EXPECT_EQ(header.header.type, network::MessageType::ORDER_ACK_BATCH);
+  ASSERT_EQ(BinaryProtocol::ntoh16(header.ack_count), orders.size());
+
+  std::vector<network::BatchAck> acks(orders.size());
+  size_t bytes = acks.size() * sizeof(network::BatchAck);
+  ASSERT_EQ(recv(sock, acks.data(), bytes, MSG_WAITALL),
+            static_cast<ssize_t>(bytes));
+
+  const BatchAckStatus expected[] = {
+      BatchAckStatus::ACCEPTED, BatchAckStatus::INSUFFICIENT_POSITION,
+      BatchAckStatus::ACCEPTED, BatchAckStatus::SYMBOL_NOT_FOUND,
+      BatchAckStatus::ACCEPTED};
+  for (size_t i = 0; i < acks.size(); ++i) {
+    EXPECT_EQ(BinaryProtocol::ntoh64(acks[i].order_id), orders[i].order_id);
+    EXPECT_EQ(acks[i].status, expected[i]) << "order " << i + 1;
+  }
+  EXPECT_EQ(acks[0].rested, 1);
+  EXPECT_EQ(BinaryProtocol::ntoh32(acks[0].filled_quantity), 0u);
+  close(sock);
+}
+
+// A resting order amended in place, repriced, then pulled
+TEST_F(NetworkTest, ReplacesAndCancelsJsonOrders) {
+  server->start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  int sock = createClientSocket();
+  EXPECT_TRUE(joinSession(sock, "trader1"));
+  auto *book = server->getSession("test_session")->getOrderBook("STOCK");
+  ASSERT_NE(book, nullptr);
+  const auto &scale = book->getPriceScale();
+
+  auto request = [&](json message) {
+    message["session_id"] = "test_session";
+    message["order_id"] = 1;
+    return json::parse(sendMessage(sock, message.dump()));
+  };
+
+  json reply = request({{"type", "new_order"},
+                        {"side", "buy"},
+                        {"price", 100.0},
+                        {"quantity", 10}});
+  EXPECT_EQ(reply["status"], "success");
+
+  reply = request({{"type", "replace"},
+                   {"side", "buy"},
+                   {"price", 100.0},
+                   {"quantity", 4}});
+  EXPECT_EQ(reply["status"], "success");
+  EXPECT_EQ(reply["message"], "Order replaced");
+  EXPECT_EQ(book->getBestBidSize(), 4u);
+
+  reply = request({{"type", "replace"},
+                   {"side", "buy"},
+                   {"price", 101.0},
+                   {"quantity", 4}});
+  EXPECT_EQ(reply["status"], "success");
+  EXPECT_EQ(book->getBestBid(), scale.toTicks(101.0));
+  EXPECT_EQ(book->getDepth(orderbook::Side::BUY, scale.toTicks(100.0)), 0u);
+
+  reply = request({{"type", "cancel"}});
+  EXPECT_EQ(reply["status"], "success");
+  EXPECT_EQ(reply["message"], "Order cancelled");
+  EXPECT_EQ(book->getBestBid(), 0);
+
+  reply = request({{"type", "cancel"}});
+  EXPECT_EQ(reply["status"], "error");
+  EXPECT_EQ(reply["message"], "Order not found");
+  close(sock);
+}
+
+// The same over the binary protocol, by the refs from JOIN_ACK
+TEST_F(NetworkTest, ReplacesAndCancelsBinaryOrders) {
+  using network::BinaryProtocol;
+  restartServer(true, network::IoBackend::defaultType());
+  auto *book = server->getSession("test_session")->getOrderBook("STOCK");
+
+  int sock = createClientSocket();
+  auto join = BinaryProtocol::serializeJoin("trader1", "test_session");
+  ASSERT_EQ(send(sock, join.data(), join.size(), 0),
+            static_cast<ssize_t>(join.size()));
+  network::JoinAckMessage join_ack;
+  auto symbol_refs = readJoinAck(sock, join_ack);
+  uint32_t session_ref = BinaryProtocol::ntoh32(join_ack.session_ref);
+  uint32_t stock = symbol_refs["STOCK"];
+
+  auto roundTrip = [&](const std::vector<uint8_t> &message) {
+    if (send(sock, message.data(), message.size(), 0) !=
+        static_cast<ssize_t>(message.size())) {
+      throw std::runtime_error("Failed to send message");
+    }
+    return readOrderAck(sock);
+  };
+
+  OrderAck ack = roundTrip(BinaryProtocol::serializeNewOrderRef(
+      1, true, 100, 10, session_ref, stock));
+  EXPECT_EQ(ack.success, 1);
+
+  ack = roundTrip(
+      BinaryProtocol::serializeReplace(1, true, 100, 3, session_ref, stock));
+  EXPECT_EQ(ack.success, 1);
+  EXPECT_STREQ(ack.message, "Order replaced");
+  EXPECT_EQ(book->getBestBidSize(), 3u);
+
+  ack = roundTrip(BinaryProtocol::serializeCancel(1, session_ref, stock));
+  EXPECT_EQ(ack.success, 1);
+  EXPECT_STREQ(ack.message, "Order cancelled");
+  EXPECT_EQ(book->getBestBid(), 0);
+
+  // The error reply is laid out without the order id
+  auto cancel = BinaryProtocol::serializeCancel(1, session_ref, stock);
+  ASSERT_EQ(send(sock, cancel.data(), cancel.size(), 0),
+            static_cast<ssize_t>(cancel.size()));
+  struct ErrorAck {
+    network::MessageHeader header;
+    char message[256];
+  } error{};
+  ASSERT_EQ(recv(sock, &error, sizeof(error), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(error)));
+  EXPECT_STREQ(error.message, "Order not found");
+  close(sock);
+}
+
+// Orders belong to the client that placed them, and a side must be named
+TEST_F(NetworkTest, RejectsJsonCancelAndReplaceFromAnotherClient) {
+  server->start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  int owner = createClientSocket();
+  int other = createClientSocket();
+  EXPECT_TRUE(joinSession(owner, "trader1"));
+  EXPECT_TRUE(joinSession(other, "trader2"));
+  auto *book = server->getSession("test_session")->getOrderBook("STOCK");
+  ASSERT_NE(book, nullptr);
+
+  auto request = [&](int sock, json message) {
+    message["session_id"] = "test_session";
+    message["order_id"] = 1;
+    return json::parse(sendMessage(sock, message.dump()));
+  };
+  json buy = {{"type", "new_order"},
+              {"side", "buy"},
+              {"price", 100.0},
+              {"quantity", 5}};
+
+  for (const char *side : {"hold", ""}) {
+    json order = buy;
+    order["side"] = side;
+    json reply = request(owner, order);
+    EXPECT_EQ(reply["status"], "error");
+    EXPECT_EQ(reply["message"], "Invalid side");
+  }
+  EXPECT_EQ(book->getBestBid(), 0);
+
+  EXPECT_EQ(request(owner, buy)["status"], "success");
+
+  json reply = request(other, {{"type", "cancel"}});
+  EXPECT_EQ(reply["status"], "error");
+  EXPECT_EQ(reply["message"], "Order not found");
+  reply = request(other, {{"type", "replace"},
+                          {"side", "buy"},
+                          {"price", 100.0},
+                          {"quantity", 1}});
+  EXPECT_EQ(reply["status"], "error");
+  EXPECT_EQ(book->getBestBidSize(), 5u);
+
+  // The owner still has to keep to the order's side
+  reply = request(owner, {{"type", "replace"},
+                          {"side", "sell"},
+                          {"price", 100.0},
+                          {"quantity", 1}});
+  EXPECT_EQ(reply["status"], "error");
+  EXPECT_EQ(book->getBestBidSize(), 5u);
+
+  EXPECT_EQ(request(owner, {{"type", "cancel"}})["status"], "success");
+  EXPECT_EQ(book->getBestBid(), 0);
+  close(owner);
+  close(other);
+}
+
+// The same over the binary protocol, including a batch entry with no side
+TEST_F(NetworkTest, RejectsBinaryCancelAndReplaceFromAnotherClient) {
+  using network::BinaryProtocol;
+  restartServer(true, network::IoBackend::defaultType());
+  auto *book = server->getSession("test_session")->getOrderBook("STOCK");
+
+  auto joinAs = [&](const char *username, uint32_t &session_ref) {
+    int sock = createClientSocket();
+    auto join = BinaryProtocol::serializeJoin(username, "test_session");
+    if (send(sock, join.data(), join.size(), 0) !=
+        static_cast<ssize_t>(join.size())) {
+      throw std::runtime_error("Failed to send join");
+    }
+    network::JoinAckMessage join_ack;
+    readJoinAck(sock, join_ack);
+    session_ref = BinaryProtocol::ntoh32(join_ack.session_ref);
+    return sock;
+  };
+  uint32_t session_ref = 0;
+  int owner = joinAs("trader1", session_ref);
+  int other = joinAs("trader2", session_ref);
+  uint32_t stock = server->getSession("test_session")->getSymbolRef("STOCK");
+
+  // Error replies are laid out without the order id
+  struct ErrorAck {
+    network::MessageHeader header;
+    char message[256];
+  };
+  auto expectError = [&](int sock, const std::vector<uint8_t> &message,
+                         const char *error) {
+    ASSERT_EQ(send(sock, message.data(), message.size(), 0),
+              static_cast<ssize_t>(message.size()));
+    ErrorAck ack{};
+    ASSERT_EQ(recv(sock, &ack, sizeof(ack), MSG_WAITALL),
+              static_cast<ssize_t>(sizeof(ack)));
+    EXPECT_STREQ(ack.message, error);
+  };
+
+  auto no_side =
+      BinaryProtocol::serializeNewOrderRef(1, true, 100, 5, session_ref, stock);
+  reinterpret_cast<network::NewOrderRefMessage *>(no_side.data())->side = 2;
+  expectError(owner, no_side, "Invalid side");
+
+  auto order =
+      BinaryProtocol::serializeNewOrderRef(1, true, 100, 5, session_ref, stock);
+  ASSERT_EQ(send(owner, order.data(), order.size(), 0),
+            static_cast<ssize_t>(order.size()));
+  EXPECT_EQ(readOrderAck(owner).success, 1);
+
+  expectError(other, BinaryProtocol::serializeCancel(1, session_ref, stock),
+              "Order not found");
+  expectError(
+      other,
+      BinaryProtocol::serializeReplace(1, true, 100, 1, session_ref, stock),
+      "Order not found or cannot be replaced");
+  EXPECT_EQ(book->getBestBidSize(), 5u);
+
+  std::vector<network::BatchOrder> orders = {{2, 2, 100, 1, stock}};
+  auto batch = BinaryProtocol::serializeNewOrderBatch(session_ref, orders);
+  ASSERT_EQ(send(owner, batch.data(), batch.size(), 0),
+            static_cast<ssize_t>(batch.size()));
+  network::OrderAckBatchMessage header;
+  ASSERT_EQ(recv(owner, &header, sizeof(header), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(header)));
+  network::BatchAck ack;
+  ASSERT_EQ(recv(owner, &ack, sizeof(ack), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(ack)));
+  EXPECT_EQ(ack.status, network::BatchAckStatus::INVALID_SIDE);
+
+  auto cancel = BinaryProtocol::serializeCancel(1, session_ref, stock);
+  ASSERT_EQ(send(owner, cancel.data(), cancel.size(), 0),
+            static_cast<ssize_t>(cancel.size()));
+  EXPECT_EQ(readOrderAck(owner).success, 1);
+  EXPECT_EQ(book->getBestBid(), 0);
+  close(owner);
+  close(other);
+}
+
+// An order for nothing is refused rather than acked as resting
+TEST_F(NetworkTest, RejectsOrdersWithNoQuantity) {
+  server->start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  int sock = createClientSocket();
+  EXPECT_TRUE(joinSession(sock, "trader1"));
+  json order = {{"type", "new_order"},
+                {"session_id", "test_session"},
+                {"side", "buy"},
+                {"price", 100.0},
+                {"quantity", 0},
+                {"order_id", 1}};
+  json reply = json::parse(sendMessage(sock, order.dump()));
+  EXPECT_EQ(reply["status"], "error");
+  EXPECT_EQ(reply["message"], "Invalid quantity");
+  auto *book = server->getSession("test_session")->getOrderBook("STOCK");
+  EXPECT_EQ(book->getBestBid(), 0);
+  close(sock);
+}
+
+TEST_F(NetworkTest, RejectsBinaryOrdersWithNoQuantity) {
+  using network::BinaryProtocol;
+  restartServer(true, network::IoBackend::defaultType());
+  auto *book = server->getSession("test_session")->getOrderBook("STOCK");
+
+  int sock = createClientSocket();
+  auto join = BinaryProtocol::serializeJoin("trader1", "test_session");
+  ASSERT_EQ(send(sock, join.data(), join.size(), 0),
+            static_cast<ssize_t>(join.size()));
+  network::JoinAckMessage join_ack;
+  auto symbol_refs = readJoinAck(sock, join_ack);
+  uint32_t session_ref = BinaryProtocol::ntoh32(join_ack.session_ref);
+  uint32_t stock = symbol_refs["STOCK"];
+
+  auto order =
+      BinaryProtocol::serializeNewOrderRef(1, true, 100, 0, session_ref, stock);
+  ASSERT_EQ(send(sock, order.data(), order.size(), 0),
+            static_cast<ssize_t>(order.size()));
+  struct ErrorAck {
+    network::MessageHeader header;
+    char message[256];
+  } error{};
+  ASSERT_EQ(recv(sock, &error, sizeof(error), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(error)));
+  EXPECT_STREQ(error.message, "Invalid quantity");
+
+  std::vector<network::BatchOrder> orders = {{2, 0, 100, 0, stock},
+                                             {3, 0, 100, 1, stock}};
+  auto batch = BinaryProtocol::serializeNewOrderBatch(session_ref, orders);
+  ASSERT_EQ(send(sock, batch.data(), batch.size(), 0),
+            static_cast<ssize_t>(batch.size()));
+  network::OrderAckBatchMessage header;
+  ASSERT_EQ(recv(sock, &header, sizeof(header), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(header)));
+  std::array<network::BatchAck, 2> acks;
+  ASSERT_EQ(recv(sock, acks.data(), sizeof(acks), MSG_WAITALL),
+            static_cast<ssize_t>(sizeof(acks)));
+  EXPECT_EQ(acks[0].status, network::BatchAckStatus::INVALID_QUANTITY);
+  EXPECT_EQ(acks[1].status, network::BatchAckStatus::ACCEPTED);
+  EXPECT_EQ(book->getBestBidSize(), 1u);
+  close(sock);
+}
+
+// A user who reconnects can still cancel what they left resting
+TEST_F(NetworkTest, CancelsOrdersAfterReconnecting) {
+  server->start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  auto *book = server->getSession("test_session")->getOrderBook("STOCK");
+
+  json order = {{"type", "new_order"},
+                {"session_id", "test_session"},
+                {"side", "buy"},
+                {"price", 100.0},
+                {"quantity", 5},
+                {"order_id", 1}};
+  int sock = createClientSocket();
+  EXPECT_TRUE(joinSession(sock, "maker"));
+  EXPECT_EQ(json::parse(sendMessage(sock, order.dump()))["status"],
+            "success");
+  close(sock);
+
+  // The name is free again once the server has seen the close
+  sock = createClientSocket();
+  bool joined = false;
+  for (int attempt = 0; attempt < 100 && !joined; ++attempt) {
+    joined = joinSession(sock, "maker");
+    if (!joined) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  ASSERT_TRUE(joined);
+  EXPECT_EQ(book->getBestBidSize(), 5u);
+
+  json cancel = {{"type", "cancel"},
+                 {"session_id", "test_session"},
+                 {"order_id", 1}};
+  EXPECT_EQ(json::parse(sendMessage(sock, cancel.dump()))["status"],
+            "success");
+  EXPECT_EQ(book->getBestBid(), 0);
+  close(sock);
+}
+
+// Clients pipelining orders at once share the event loops while their
+// orders are out on the shards, and each gets its replies back in order
+TEST_F(NetworkTest, ServesPipelinedOrdersFromManyClients) {
+  constexpr int NUM_CLIENTS = 16;
+  constexpr int ORDERS_PER_CLIENT = 50;
+
+  for (auto backend :
+       {network::IoBackendType::EPOLL, network::IoBackendType::IO_URING}) {
+    try {
+      restartServer(false, backend);
+    } catch (const std::exception &) {
+      continue; // not on this platform or kernel
+    }
+
+    // Order ids are unique across the book, so each client has its own
+    std::vector<int> sockets;
+    for (int i = 0; i < NUM_CLIENTS; ++i) {
+      sockets.push_back(createClientSocket());
+      ASSERT_TRUE(joinSession(sockets[i], "trader" + std::to_string(i)));
+
+      std::string stream;
+      for (int n = 1; n <= ORDERS_PER_CLIENT; ++n) {
+        stream += json{{"type", "new_order"},
+                       {"session_id", "test_session"},
+                       {"side", "buy"},
+                       {"price", 1.0},
+                       {"quantity", 1},
+                       {"order_id", i * ORDERS_PER_CLIENT + n}}
+                      .dump() +
+                  "\n";
+      }
+      ASSERT_EQ(send(sockets[i], stream.data(), stream.size(), 0),
+                static_cast<ssize_t>(stream.size()));
+    }
+
+    for (int i = 0; i < NUM_CLIENTS; ++i) {
+      std::string replies;
+      std::array<char, 4096> buffer;
+      while (std::count(replies.begin(), replies.end(), '\n') <
+             ORDERS_PER_CLIENT) {
+        ssize_t bytes = recv(sockets[i], buffer.data(), buffer.size(), 0);
+        ASSERT_GT(bytes, 0);
+        replies.append(buffer.data(), bytes);
+      }
+
+      std::istringstream lines(replies);
+      std::string line;
+      for (int n = 1; n <= ORDERS_PER_CLIENT; ++n) {
+        std::getline(lines, line);
+        json reply = json::parse(line);
+        EXPECT_EQ(reply["status"], "success") << line;
+        EXPECT_EQ(reply["order_id"], i * ORDERS_PER_CLIENT + n);
+      }
+      close(sockets[i]);
+    }
+  }
+}
@@ -1,10 +1,54 @@
+#include "../include/network/thread_pool.hpp"
 #include "../include/orderbook/order_allocator.hpp"
 #include "../include/orderbook/orderbook.hpp"
 #include "../include/session/session.hpp"
+#include "support/allocation_counter.hpp"
+#include <array>
+#include <chrono>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <mutex>
+#include <set>
+#include <string>
 #include <thread>
 #include <vector>
 
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+namespace {
+
+// Threads currently alive in this process, 0 if the platform can't tell
+size_t processThreadCount() {
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("Threads:", 0) == 0) {
+      return std::stoul(line.substr(8));
+    }
+  }
+  return 0;
+#elif defined(__APPLE__)
+  thread_act_array_t threads;
+  mach_msg_type_number_t count = 0;
+  if (task_threads(mach_task_self(), &threads, &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  for (mach_msg_type_number_t i = 0; i < count; ++i) {
+    mach_port_deallocate(mach_task_self(), threads[i]);
+  }
+  vm_deallocate(mach_task_self(), reinterpret_cast<vm_address_t>(threads),
+                count * sizeof(thread_act_t));
+  return count;
+#else
+  return 0;
+#endif
+}
+
+} // namespace
+
 using namespace orderbook;
 using namespace session;
 
@@ -24,13 +68,17 @@ protected:
   std::unique_ptr<Session> session;
   static uint64_t next_id;
 
+  static Price ticks(double price) { return PriceScale{}.toTicks(price); }
+
   // Helper methods now return Order pointers
   Order *createBuyOrder(double price, uint32_t quantity) {
-    return OrderAllocator::create(++next_id, Side::BUY, price, quantity);
+    return OrderAllocator::create(++next_id, Side::BUY, ticks(price),
+                                  quantity);
   }
 
   Order *createSellOrder(double price, uint32_t quantity) {
-    return OrderAllocator::create(++next_id, Side::SELL, price, quantity);
+    return OrderAllocator::create(++next_id, Side::SELL, ticks(price),
+                                  quantity);
   }
 
   // Helper to get test users
@@ -43,14 +91,14 @@ uint64_t OrderBookTest::next_id = 0;
 TEST_F(OrderBookTest, CanAddBuyOrder) {
   Order *order = createBuyOrder(100.0, 10);
   EXPECT_TRUE(book.addOrder(*order));
-  EXPECT_EQ(book.getBestBid(), 100.0);
+  EXPECT_EQ(book.getBestBid(), ticks(100.0));
   OrderAllocator::destroy(order);
 }
 
 TEST_F(OrderBookTest, CanAddSellOrder) {
   Order *order = createSellOrder(100.0, 10);
   EXPECT_TRUE(book.addOrder(*order));
-  EXPECT_EQ(book.getBestAsk(), 100.0);
+  EXPECT_EQ(book.getBestAsk(), ticks(100.0));
   OrderAllocator::destroy(order);
 }
 
@@ -63,7 +111,7 @@ TEST_F(OrderBookTest, MaintainsBestBidPrices) {
   book.addOrder(*order2);
   book.addOrder(*order3);
 
-  EXPECT_EQ(book.getBestBid(), 101.0);
+  EXPECT_EQ(book.getBestBid(), ticks(101.0));
 
   OrderAllocator::destroy(order1);
   OrderAllocator::destroy(order2);
@@ -79,7 +127,7 @@ TEST_F(OrderBookTest, MaintainsBestAskPrices) {
   book.addOrder(*order2);
   book.addOrder(*order3);
 
-  EXPECT_EQ(book.getBestAsk(), 99.0);
+  EXPECT_EQ(book.getBestAsk(), ticks(99.0));
 
   OrderAllocator::destroy(order1);
   OrderAllocator::destroy(order2);
@@ -99,7 +147,7 @@ TEST_F(OrderBookTest, MatchesBuyWithExistingSell) {
   auto result = book.matchOrder(*buy);
 
   EXPECT_TRUE(result.has_value());
-  EXPECT_EQ(book.getBestAsk(), 0.0);
+  EXPECT_EQ(book.getBestAsk(), 0);
 
   // Verify trader balances and positions
   double trade_value = 100.0 * 10;
@@ -126,7 +174,7 @@ TEST_F(OrderBookTest, HandlesPartialFills) {
   auto result = book.matchOrder(*buy);
 
   EXPECT_TRUE(result.has_value());
-  EXPECT_EQ(book.getBestAsk(), 100.0);
+  EXPECT_EQ(book.getBestAsk(), ticks(100.0));
 
   // Verify partial fill amounts
   double trade_value = 100.0 * 5;
@@ -140,6 +188,415 @@ TEST_F(OrderBookTest, HandlesPartialFills) {
   OrderAllocator::destroy(buy);
 }
 
+TEST_F(OrderBookTest, CancelsRestingOrder) {
+  Order *order1 = createBuyOrder(100.0, 10);
+  Order *order2 = createBuyOrder(101.0, 10);
+  book.addOrder(*order1);
+  book.addOrder(*order2);
+
+  EXPECT_TRUE(book.cancelOrder(order2->getId()));
+  EXPECT_EQ(book.getBestBid(), ticks(100.0));
+  EXPECT_FALSE(book.cancelOrder(order2->getId()));
+  EXPECT_FALSE(book.cancelOrder(next_id + 1));
+
+  EXPECT_TRUE(book.cancelOrder(order1->getId()));
+  EXPECT_EQ(book.getBestBid(), 0);
+
+  OrderAllocator::destroy(order1);
+  OrderAllocator::destroy(order2);
+}
+
+TEST_F(OrderBookTest, CancelPreservesQueuePriority) {
+  std::vector<Order *> sells;
+  for (int i = 0; i < 100; ++i) {
+    sells.push_back(createSellOrder(100.0, 1));
+    book.addOrder(*sells.back());
+  }
+
+  // Cancel every other order from the middle of the queue
+  for (size_t i = 0; i < sells.size(); i += 2) {
+    EXPECT_TRUE(book.cancelOrder(sells[i]->getId()));
+  }
+
+  for (size_t i = 1; i < sells.size(); i += 2) {
+    Order *buy = createBuyOrder(100.0, 1);
+    auto result = book.matchOrder(*buy);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->getId(), sells[i]->getId());
+    OrderAllocator::destroy(buy);
+  }
+  EXPECT_EQ(book.getBestAsk(), 0);
+
+  for (auto *order : sells) {
+    OrderAllocator::destroy(order);
+  }
+}
+
+TEST_F(OrderBookTest, ReplaceKeepsPriorityOnlyWhenQuantityDrops) {
+  std::vector<Order *> sells = {createSellOrder(100.0, 10),
+                                createSellOrder(100.0, 10)};
+  for (auto *order : sells) {
+    book.addOrder(*order);
+  }
+  std::array<Fill, 4> fills;
+
+  // Smaller in place, still first in the queue
+  MatchResult result = book.replaceOrder(sells[0]->getId(), Side::SELL,
+                                         ticks(100.0), 4, fills);
+  EXPECT_TRUE(result.accepted);
+  EXPECT_TRUE(result.rested);
+  EXPECT_EQ(result.fill_count, 0);
+  EXPECT_EQ(book.getBestAskSize(), 14);
+
+  Order *probe = createBuyOrder(100.0, 1);
+  std::optional<Order> front = book.matchOrder(*probe);
+  ASSERT_TRUE(front.has_value());
+  EXPECT_EQ(front->getId(), sells[0]->getId());
+  EXPECT_EQ(front->getLeavesQuantity(), 4);
+
+  // Larger goes to the back of the level
+  result = book.replaceOrder(sells[0]->getId(), Side::SELL, ticks(100.0), 8,
+                             fills);
+  EXPECT_TRUE(result.accepted);
+  EXPECT_EQ(book.getBestAskSize(), 18);
+  front = book.matchOrder(*probe);
+  ASSERT_TRUE(front.has_value());
+  EXPECT_EQ(front->getId(), sells[1]->getId());
+
+  // Unknown id, wrong side and a zero quantity leave the book alone
+  EXPECT_FALSE(book.replaceOrder(next_id + 1, Side::SELL, ticks(100.0), 1,
+                                 fills)
+                   .accepted);
+  EXPECT_FALSE(book.replaceOrder(sells[0]->getId(), Side::BUY, ticks(100.0),
+                                 1, fills)
+                   .accepted);
+  EXPECT_FALSE(book.replaceOrder(sells[0]->getId(), Side::SELL, ticks(100.0),
+                                 0, fills)
+                   .accepted);
+  EXPECT_EQ(book.getBestAskSize(), 17);
+
+  OrderAllocator::destroy(probe);
+  for (auto *order : sells) {
+    OrderAllocator::destroy(order);
+  }
+}
+
+TEST_F(OrderBookTest, ReplaceRepricesAndSweeps) {
+  Order *sell = createSellOrder(101.0, 5);
+  Order *buy = createBuyOrder(99.0, 8);
+  book.addOrder(*sell);
+  book.addOrder(*buy);
+
+  // The bid moves up through the ask, fills and rests the rest
+  std::array<Fill, 4> fills;
+  MatchResult result =
+      book.replaceOrder(buy->getId(), Side::BUY, ticks(101.0), 8, fills);
+  EXPECT_TRUE(result.accepted);
+  EXPECT_TRUE(result.rested);
+  ASSERT_EQ(result.fill_count, 1);
+  EXPECT_EQ(fills[0].maker_id, sell->getId());
+  EXPECT_EQ(fills[0].taker_id, buy->getId());
+  EXPECT_EQ(result.remaining_quantity, 3);
+  EXPECT_EQ(book.getBestBid(), ticks(101.0));
+  EXPECT_EQ(book.getBestBidSize(), 3);
+  EXPECT_EQ(book.getBestAsk(), 0);
+  EXPECT_EQ(book.getDepth(Side::BUY, ticks(99.0)), 0);
+
+  // A price the ladder cannot hold is refused before the order moves
+  OrderBook ladder(LadderConfig{ticks(0.01), ticks(90.0), ticks(110.0)});
+  ladder.addOrder(*buy);
+  EXPECT_FALSE(
+      ladder.replaceOrder(buy->getId(), Side::BUY, ticks(120.0), 8, fills)
+          .accepted);
+  EXPECT_EQ(ladder.getBestBid(), ticks(99.0));
+  EXPECT_EQ(ladder.getBestBidSize(), 8);
+
+  OrderAllocator::destroy(sell);
+  OrderAllocator::destroy(buy);
+}
+
+TEST_F(OrderBookTest, RejectsOrdersWithNoQuantity) {
+  Order *sell = createSellOrder(100.0, 5);
+  Order *empty_buy = createBuyOrder(100.0, 0);
+  Order *empty_sell = createSellOrder(101.0, 0);
+  book.addOrder(*sell);
+  std::array<Fill, 4> fills;
+
+  EXPECT_FALSE(book.addOrder(*empty_sell));
+  EXPECT_FALSE(book.addOrder(*empty_buy, fills).accepted);
+  EXPECT_FALSE(book.matchOrder(*empty_buy, fills).accepted);
+  EXPECT_EQ(book.getBestAsk(), ticks(100.0));
+  EXPECT_EQ(book.getBestAskSize(), 5);
+
+  OrderAllocator::destroy(sell);
+  OrderAllocator::destroy(empty_buy);
+  OrderAllocator::destroy(empty_sell);
+}
+
+// An order added with an owner is only reachable under that owner, and keeps
+// it when a replace moves it
+TEST_F(OrderBookTest, OnlyTheOwnerCancelsOrReplaces) {
+  Order *sell =
+      OrderAllocator::create(++next_id, Side::SELL, ticks(100.0), 10, 7);
+  book.addOrder(*sell);
+  std::array<Fill, 4> fills;
+
+  EXPECT_FALSE(book.cancelOrder(sell->getId()));
+  EXPECT_FALSE(book.cancelOrder(sell->getId(), 8));
+  EXPECT_FALSE(book.replaceOrder(sell->getId(), Side::SELL, ticks(100.0), 4,
+                                 fills, 8)
+                   .accepted);
+  EXPECT_EQ(book.getBestAskSize(), 10);
+
+  EXPECT_TRUE(book.replaceOrder(sell->getId(), Side::SELL, ticks(101.0), 4,
+                                fills, 7)
+                  .accepted);
+  EXPECT_EQ(book.getBestAsk(), ticks(101.0));
+  EXPECT_FALSE(book.cancelOrder(sell->getId()));
+  EXPECT_TRUE(book.cancelOrder(sell->getId(), 7));
+  EXPECT_EQ(book.getBestAsk(), 0);
+
+  OrderAllocator::destroy(sell);
+}
+
+// Queued commands carry the owner through to the book
+TEST_F(OrderBookTest, QueuedCommandsKeepTheirOwner) {
+  OrderBook owned(PriceScale{}, WriterMode::SINGLE_WRITER);
+  owned.post(BookCommand{BookCommandType::ADD, 1, Side::BUY, ticks(100.0), 5,
+                         7});
+  owned.post(BookCommand{BookCommandType::CANCEL, 1, Side::BUY, 0, 0});
+  owned.post(BookCommand{BookCommandType::CANCEL, 1, Side::BUY, 0, 0, 8});
+
+  std::vector<bool> accepted;
+  size_t applied =
+      owned.drain([&](const BookCommand &, const MatchResult &result) {
+        accepted.push_back(result.accepted);
+      });
+  EXPECT_EQ(applied, 3u);
+  EXPECT_EQ(accepted, (std::vector<bool>{true, false, false}));
+  EXPECT_EQ(owned.getBestBidSize(), 5);
+
+  owned.post(BookCommand{BookCommandType::CANCEL, 1, Side::BUY, 0, 0, 7});
+  EXPECT_EQ(owned.drain(), 1u);
+  EXPECT_EQ(owned.getBestBid(), 0);
+}
+
+TEST_F(OrderBookTest, LadderBookTracksBestPrices) {
+  OrderBook ladder(LadderConfig{ticks(0.5), ticks(50.0), ticks(150.0)});
+
+  // Spread over several bitmap words so the cursor has to scan across them
+  std::vector<Order *> bids = {createBuyOrder(60.0, 10),
+                               createBuyOrder(99.5, 10),
+                               createBuyOrder(140.0, 10)};
+  std::vector<Order *> asks = {createSellOrder(149.0, 10),
+                               createSellOrder(141.5, 10)};
+  for (auto *order : bids) {
+    EXPECT_TRUE(ladder.addOrder(*order));
+  }
+  for (auto *order : asks) {
+    EXPECT_TRUE(ladder.addOrder(*order));
+  }
+
+  EXPECT_EQ(ladder.getBestBid(), ticks(140.0));
+  EXPECT_EQ(ladder.getBestAsk(), ticks(141.5));
+
+  EXPECT_TRUE(ladder.cancelOrder(bids[2]->getId()));
+  EXPECT_EQ(ladder.getBestBid(), ticks(99.5));
+  EXPECT_TRUE(ladder.cancelOrder(bids[1]->getId()));
+  EXPECT_EQ(ladder.getBestBid(), ticks(60.0));
+  EXPECT_TRUE(ladder.cancelOrder(asks[1]->getId()));
+  EXPECT_EQ(ladder.getBestAsk(), ticks(149.0));
+
+  Order *buy = createBuyOrder(149.0, 10);
+  auto result = ladder.matchOrder(*buy);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->getId(), asks[0]->getId());
+  EXPECT_EQ(ladder.getBestAsk(), 0);
+
+  OrderAllocator::destroy(buy);
+  for (auto *order : bids) {
+    OrderAllocator::destroy(order);
+  }
+  for (auto *order : asks) {
+    OrderAllocator::destroy(order);
+  }
+}
+
+TEST_F(OrderBookTest, LadderBookRejectsUnrepresentablePrices) {
+  OrderBook ladder(LadderConfig{ticks(0.5), ticks(50.0), ticks(150.0)});
+
+  Order *off_tick = createBuyOrder(100.2, 10);
+  Order *below_band = createBuyOrder(49.5, 10);
+  Order *above_band = createSellOrder(150.5, 10);
+
+  EXPECT_FALSE(ladder.addOrder(*off_tick));
+  EXPECT_FALSE(ladder.addOrder(*below_band));
+  EXPECT_FALSE(ladder.addOrder(*above_band));
+  EXPECT_EQ(ladder.getBestBid(), 0);
+  EXPECT_EQ(ladder.getBestAsk(), 0);
+
+  EXPECT_THROW(OrderBook(LadderConfig{0, ticks(50.0), ticks(150.0)}),
+               std::invalid_argument);
+
+  OrderAllocator::destroy(off_tick);
+  OrderAllocator::destroy(below_band);
+  OrderAllocator::destroy(above_band);
+}
+
+TEST_F(OrderBookTest, SessionCreatesLadderBookPerSymbol) {
+  session->createOrderBook(
+      "TICK", LadderConfig{ticks(0.01), ticks(90.0), ticks(110.0)});
+  auto *ladder = session->getOrderBook("TICK");
+  ASSERT_NE(ladder, nullptr);
+
+  Order *order = createBuyOrder(200.0, 10);
+  EXPECT_FALSE(ladder->addOrder(*order));
+  OrderAllocator::destroy(order);
+}
+
+TEST_F(OrderBookTest, CreatingBooksSpawnsNoThreads) {
+  const size_t num_books = 10000;
+  auto executor = std::make_shared<network::ThreadPool>();
+  executor->init(2);
+  Session shared_session("many_books", executor);
+  EXPECT_EQ(shared_session.getExecutor(), executor.get());
+
+  size_t threads_before = processThreadCount();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_books; ++i) {
+    shared_session.createOrderBook("SYM" + std::to_string(i));
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_EQ(shared_session.getAvailableSymbols().size(), num_books);
+  EXPECT_EQ(processThreadCount(), threads_before);
+  EXPECT_LT(elapsed, std::chrono::seconds(2));
+}
+
+TEST_F(OrderBookTest, FixedPointPricesShareLevels) {
+  // 0.1 + 0.2 != 0.3 in floating point, but both land on the same tick
+  Order *order1 = createSellOrder(0.1 + 0.2, 10);
+  Order *order2 = createSellOrder(0.3, 10);
+  book.addOrder(*order1);
+  book.addOrder(*order2);
+  EXPECT_EQ(order1->getPrice(), order2->getPrice());
+
+  EXPECT_TRUE(book.cancelOrder(order1->getId()));
+  EXPECT_EQ(book.getBestAsk(), ticks(0.3));
+
+  PriceScale cents{100};
+  EXPECT_EQ(cents.toTicks(101.25), 10125);
+  EXPECT_DOUBLE_EQ(cents.toDouble(10125), 101.25);
+
+  OrderAllocator::destroy(order1);
+  OrderAllocator::destroy(order2);
+}
+
+TEST_F(OrderBookTest, SweepsLevelsAndRestsRemainder) {
+  std::vector<Order *> sells = {createSellOrder(100.0, 5),
+                                createSellOrder(100.0, 5),
+                                createSellOrder(101.0, 5),
+                                createSellOrder(102.0, 5)};
+  for (auto *order : sells) {
+    book.addOrder(*order);
+  }
+
+  std::array<Fill, 8> fills;
+  Order *buy = createBuyOrder(101.0, 17);
+  MatchResult result = book.addOrder(*buy, fills);
+
+  EXPECT_TRUE(result.accepted);
+  EXPECT_TRUE(result.rested);
+  ASSERT_EQ(result.fill_count, 3);
+  EXPECT_EQ(result.filled_quantity, 15);
+  EXPECT_EQ(result.remaining_quantity, 2);
+
+  EXPECT_EQ(fills[0].maker_id, sells[0]->getId());
+  EXPECT_EQ(fills[1].maker_id, sells[1]->getId());
+  EXPECT_EQ(fills[2].maker_id, sells[2]->getId());
+  EXPECT_EQ(fills[2].taker_id, buy->getId());
+  EXPECT_EQ(fills[2].price, ticks(101.0));
+  EXPECT_EQ(fills[2].quantity, 5);
+
+  EXPECT_EQ(book.getBestBid(), ticks(101.0));
+  EXPECT_EQ(book.getBestAsk(), ticks(102.0));
+
+  OrderAllocator::destroy(buy);
+  for (auto *order : sells) {
+    OrderAllocator::destroy(order);
+  }
+}
+
+TEST_F(OrderBookTest, SweepStopsWhenFillBufferIsFull) {
+  std::vector<Order *> sells = {createSellOrder(100.0, 5),
+                                createSellOrder(101.0, 5)};
+  for (auto *order : sells) {
+    book.addOrder(*order);
+  }
+
+  std::array<Fill, 1> fills;
+  Order *buy = createBuyOrder(101.0, 10);
+  MatchResult result = book.addOrder(*buy, fills);
+
+  EXPECT_EQ(result.fill_count, 1);
+  EXPECT_EQ(result.remaining_quantity, 5);
+  EXPECT_FALSE(result.rested);
+  EXPECT_EQ(book.getBestBid(), 0);
+  EXPECT_EQ(book.getBestAsk(), ticks(101.0));
+
+  // Matching without resting drops whatever does not fill
+  Order *rest = createBuyOrder(101.0, 8);
+  result = book.matchOrder(*rest, fills);
+  EXPECT_EQ(result.filled_quantity, 5);
+  EXPECT_FALSE(result.rested);
+  EXPECT_EQ(book.getBestBid(), 0);
+  EXPECT_EQ(book.getBestAsk(), 0);
+
+  OrderAllocator::destroy(buy);
+  OrderAllocator::destroy(rest);
+  for (auto *order : sells) {
+    OrderAllocator::destroy(order);
+  }
+}
+
+TEST_F(OrderBookTest, PartialFillsReduceLeavesAndDepth) {
+  std::vector<Order *> sells = {createSellOrder(100.0, 10),
+                                createSellOrder(100.0, 7)};
+  for (auto *order : sells) {
+    book.addOrder(*order);
+  }
+  EXPECT_EQ(book.getBestAskSize(), 17);
+  EXPECT_EQ(book.getDepth(Side::SELL, ticks(100.0)), 17);
+
+  std::array<Fill, 4> fills;
+  Order *buy = createBuyOrder(100.0, 4);
+  MatchResult result = book.matchOrder(*buy, fills);
+  EXPECT_EQ(result.filled_quantity, 4);
+  EXPECT_EQ(book.getBestAskSize(), 13);
+
+  // The front order keeps its priority and reports what is left of it
+  Order *probe = createBuyOrder(100.0, 1);
+  std::optional<Order> front = book.matchOrder(*probe);
+  ASSERT_TRUE(front.has_value());
+  EXPECT_EQ(front->getId(), sells[0]->getId());
+  EXPECT_EQ(front->getQuantity(), 10);
+  EXPECT_EQ(front->getLeavesQuantity(), 6);
+  EXPECT_EQ(book.getBestAskSize(), 12);
+
+  // Cancelling a partially filled order removes only its leaves
+  EXPECT_TRUE(book.cancelOrder(sells[0]->getId()));
+  EXPECT_EQ(book.getBestAskSize(), 7);
+  EXPECT_TRUE(book.cancelOrder(sells[1]->getId()));
+  EXPECT_EQ(book.getBestAskSize(), 0);
+  EXPECT_EQ(book.getDepth(Side::SELL, ticks(100.0)), 0);
+
+  OrderAllocator::destroy(buy);
+  OrderAllocator::destroy(probe);
+  for (auto *order : sells) {
+    OrderAllocator::destroy(order);
+  }
+}
+
 TEST_F(OrderBookTest, RespectsUserBalance) {
   auto trader = getTrader1();
   double price = 20000.0; // More than initial balance
@@ -191,7 +648,7 @@ TEST_F(OrderBookTest, MemoryPoolBasicCounting) {
             << std::endl;
 
   // Create a single order
-  Order *order = OrderAllocator::create(1, Side::BUY, 100.0, 10);
+  Order *order = OrderAllocator::create(1, Side::BUY, ticks(100.0), 10);
   std::cout << "After create: " << OrderAllocator::get_active_order_count()
             << std::endl;
 
@@ -218,7 +675,7 @@ TEST_F(OrderBookTest, MemoryPoolStressTest) {
       try {
         auto *order = OrderAllocator::create(
             thread_id * NUM_OPERATIONS + i, i % 2 == 0 ? Side::BUY : Side::SELL,
-            100.0 + (i % 100), 1 + (i % 50));
+            ticks(100.0 + (i % 100)), 1 + (i % 50));
         orders.push_back(order);
         total_allocations.fetch_add(1, std::memory_order_relaxed);
       } catch (const std::runtime_error &e) {
@@ -256,6 +713,198 @@ TEST_F(OrderBookTest, MemoryPoolStressTest) {
   EXPECT_GT(OrderAllocator::get_allocated_block_count(), 0);
 }
 
+TEST_F(OrderBookTest, MemoryPoolRecyclesAcrossThreads) {
+  constexpr size_t NUM_ORDERS = 1000;
+  MemoryPool<Order> pool;
+  std::vector<Order *> orders(NUM_ORDERS);
+
+  // Allocated on one thread, freed on another
+  std::thread producer([&]() {
+    for (size_t i = 0; i < NUM_ORDERS; ++i) {
+      orders[i] = pool.allocate(uint64_t{i}, Side::BUY, Price{1}, 1u);
+    }
+  });
+  producer.join();
+  EXPECT_EQ(pool.get_active_object_count(), NUM_ORDERS);
+
+  std::thread consumer([&]() {
+    for (auto *order : orders) {
+      pool.deallocate(order);
+    }
+  });
+  consumer.join();
+  EXPECT_EQ(pool.get_active_object_count(), 0);
+
+  // Exiting threads hand their cached nodes back, so a stream of short-lived
+  // threads reuses the same memory instead of growing the pool
+  size_t blocks = pool.get_allocated_block_count();
+  for (int round = 0; round < 50; ++round) {
+    std::thread worker([&]() {
+      for (size_t i = 0; i < NUM_ORDERS; ++i) {
+        orders[i] = pool.allocate(uint64_t{i}, Side::SELL, Price{1}, 1u);
+      }
+      for (auto *order : orders) {
+        pool.deallocate(order);
+      }
+    });
+    worker.join();
+  }
+  EXPECT_EQ(pool.get_allocated_block_count(), blocks);
+  EXPECT_EQ(pool.get_active_object_count(), 0);
+}
+
+TEST_F(OrderBookTest, GeometricPoolGrowsPastFixedCeiling) {
+  // Well past the ~90k orders a FIXED pool's MAX_BLOCKS allows
+  constexpr size_t NUM_ORDERS = 200000;
+  MemoryPool<Order> pool(PoolOptions{PoolGrowth::GEOMETRIC});
+  std::vector<Order *> orders;
+  orders.reserve(NUM_ORDERS);
+
+  for (size_t i = 0; i < NUM_ORDERS; ++i) {
+    orders.push_back(pool.allocate(uint64_t{i}, Side::BUY, Price{1}, 1u));
+  }
+  EXPECT_EQ(pool.get_active_object_count(), NUM_ORDERS);
+  // Doubling slabs keep the slab count logarithmic in the live count
+  EXPECT_LT(pool.get_allocated_block_count(), 16);
+
+  for (auto *order : orders) {
+    pool.deallocate(order);
+  }
+  EXPECT_EQ(pool.get_active_object_count(), 0);
+}
+
+TEST_F(OrderBookTest, ReservedPoolSetsUpNoSlabsWhileAllocating) {
+  PoolOptions options;
+  options.growth = PoolGrowth::GEOMETRIC;
+  options.reserve_objects = 50000;
+  MemoryPool<Order> pool(options);
+  size_t slabs = pool.get_allocated_block_count();
+
+  // Leave headroom for the nodes a magazine carves ahead of use
+  std::vector<Order *> orders;
+  for (size_t i = 0; i < 49000; ++i) {
+    orders.push_back(pool.allocate(uint64_t{i}, Side::SELL, Price{1}, 1u));
+  }
+  EXPECT_EQ(pool.get_allocated_block_count(), slabs);
+
+  for (auto *order : orders) {
+    pool.deallocate(order);
+  }
+}
+
+TEST_F(OrderBookTest, LockFreePoolStressTest) {
+  constexpr size_t NUM_THREADS = 8;
+  constexpr size_t ROUNDS = 200;
+  constexpr size_t BATCH = 100; // beyond a magazine, so batches cross threads
+  PoolOptions options;
+  options.growth = PoolGrowth::GEOMETRIC;
+  options.free_list_mode = FreeListMode::LOCK_FREE;
+  MemoryPool<Order> pool(options);
+
+  // Orders are handed to whichever thread picks them up next and freed
+  // there. Every order carries its own id, so two threads ever holding the
+  // same node shows up as a mismatch.
+  std::mutex handoff_mutex;
+  std::vector<std::pair<Order *, uint64_t>> handoff;
+  std::atomic<size_t> corrupted{0};
+
+  auto worker = [&](size_t thread_id) {
+    std::vector<std::pair<Order *, uint64_t>> mine;
+    for (size_t round = 0; round < ROUNDS; ++round) {
+      for (size_t i = 0; i < BATCH; ++i) {
+        uint64_t id = (thread_id * ROUNDS + round) * BATCH + i;
+        mine.emplace_back(pool.allocate(id, Side::BUY, Price{1}, 1u), id);
+      }
+      {
+        std::lock_guard<std::mutex> lock(handoff_mutex);
+        std::swap(mine, handoff);
+      }
+      for (auto [order, id] : mine) {
+        if (order->getId() != id) {
+          corrupted++;
+        }
+        pool.deallocate(order);
+      }
+      mine.clear();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(worker, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (auto [order, id] : handoff) {
+    if (order->getId() != id) {
+      corrupted++;
+    }
+    pool.deallocate(order);
+  }
+
+  EXPECT_EQ(corrupted, 0);
+  EXPECT_EQ(pool.get_active_object_count(), 0);
+}
+
+TEST_F(OrderBookTest, LevelChurnMakesNoGlobalAllocations) {
+  std::vector<Order *> orders;
+  for (int i = 0; i < 100; ++i) {
+    orders.push_back(createBuyOrder(90.0 - i, 5));
+    orders.push_back(createSellOrder(110.0 + i, 5));
+  }
+
+  // Opens and empties a fresh level on each side every round
+  auto churn = [&](OrderBook &target) {
+    for (auto *order : orders) {
+      target.addOrder(*order);
+      target.cancelOrder(order->getId());
+    }
+  };
+
+  OrderBook ladder(LadderConfig{ticks(1.0), ticks(1.0), ticks(300.0)});
+  for (OrderBook *target : {&book, &ladder}) {
+    churn(*target); // warm up the node pools
+    allocations::counting_thread = true;
+    allocations::thread_count = 0;
+    churn(*target);
+    allocations::counting_thread = false;
+    EXPECT_EQ(allocations::thread_count, 0u);
+  }
+
+  for (auto *order : orders) {
+    OrderAllocator::destroy(order);
+  }
+}
+
+TEST_F(OrderBookTest, NumaLocalPoolGivesEachOrderItsOwnCacheLine) {
+  PoolOptions options;
+  options.cache_line_slots = true;
+  options.numa_local = true;
+  MemoryPool<Order> pool(options);
+  EXPECT_GE(pool.get_arena_count(), 1u);
+  EXPECT_EQ(pool.get_slot_size() % 64, 0u);
+
+  std::vector<Order *> orders;
+  std::set<uintptr_t> lines;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    Order *order = pool.allocate(i, Side::BUY, Price{1}, 1u);
+    auto address = reinterpret_cast<uintptr_t>(order);
+    EXPECT_EQ(address % 64, 0u);
+    lines.insert(address / 64);
+    orders.push_back(order);
+  }
+  EXPECT_EQ(lines.size(), orders.size());
+
+  // Freed on another thread, which may sit on another node's arena
+  std::thread([&] {
+    for (auto *order : orders) {
+      pool.deallocate(order);
+    }
+  }).join();
+  EXPECT_EQ(pool.get_active_object_count(), 0);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
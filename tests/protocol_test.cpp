@@ -1,6 +1,9 @@
+#include "../include/network/frame_decoder.hpp"
+#include "../include/network/json_protocol.hpp"
 #include "../include/network/protocol.hpp"
 #include "../include/network/zero_copy.hpp"
 #include "fcntl.h"
+#include <cstring>
 #include <gtest/gtest.h>
 #include <thread>
 
@@ -26,6 +29,35 @@ TEST_F(ProtocolTest, SerializationRoundTrip) {
   EXPECT_EQ(std::string(msg->session_id), session_id);
 }
 
+// Entries go out in network byte order behind one header sized for all
+TEST_F(ProtocolTest, OrderBatchSerialisation) {
+  std::vector<BatchOrder> orders = {{7, 0, 1502500, 100, 0},
+                                    {8, 1, 1503000, 50, 3}};
+  auto data = BinaryProtocol::serializeNewOrderBatch(42, orders);
+  ASSERT_EQ(data.size(),
+            sizeof(NewOrderBatchMessage) + 2 * sizeof(BatchOrder));
+
+  auto *msg = reinterpret_cast<const NewOrderBatchMessage *>(data.data());
+  EXPECT_EQ(msg->header.type, MessageType::NEW_ORDER_BATCH);
+  EXPECT_EQ(BinaryProtocol::ntoh16(msg->header.length),
+            data.size() - sizeof(MessageHeader));
+  EXPECT_EQ(BinaryProtocol::ntoh32(msg->session_ref), 42u);
+  EXPECT_EQ(BinaryProtocol::ntoh16(msg->order_count), 2);
+
+  auto *entries = reinterpret_cast<const BatchOrder *>(
+      data.data() + sizeof(NewOrderBatchMessage));
+  EXPECT_EQ(BinaryProtocol::ntoh64(entries[1].order_id), 8u);
+  EXPECT_EQ(entries[1].side, 1);
+  EXPECT_EQ(static_cast<int64_t>(BinaryProtocol::ntoh64(entries[1].price)),
+            1503000);
+  EXPECT_EQ(BinaryProtocol::ntoh32(entries[1].quantity), 50u);
+  EXPECT_EQ(BinaryProtocol::ntoh32(entries[1].symbol_ref), 3u);
+
+  std::vector<BatchOrder> too_many(MAX_BATCH_ORDERS + 1);
+  EXPECT_THROW(BinaryProtocol::serializeNewOrderBatch(42, too_many),
+               std::invalid_argument);
+}
+
 TEST_F(ProtocolTest, NetworkByteOrderConversion) {
   // Test double conversion
   double original = 123.456;
@@ -48,15 +80,17 @@ TEST_F(ProtocolTest, MarketDataMessage) {
 
   const char *symbol = "AAPL";
   strncpy(msg.symbol, symbol, sizeof(msg.symbol) - 1);
-  msg.best_bid = BinaryProtocol::htonDouble(150.25);
-  msg.best_ask = BinaryProtocol::htonDouble(150.30);
+  msg.best_bid = BinaryProtocol::hton64(1502500); // 150.25 in ticks
+  msg.best_ask = BinaryProtocol::hton64(1503000); // 150.30 in ticks
   msg.bid_size = BinaryProtocol::hton32(100);
   msg.ask_size = BinaryProtocol::hton32(150);
 
   // Verify fields
   EXPECT_EQ(std::string(msg.symbol), "AAPL");
-  EXPECT_DOUBLE_EQ(BinaryProtocol::ntohDouble(msg.best_bid), 150.25);
-  EXPECT_DOUBLE_EQ(BinaryProtocol::ntohDouble(msg.best_ask), 150.30);
+  EXPECT_EQ(static_cast<int64_t>(BinaryProtocol::ntoh64(msg.best_bid)),
+            1502500);
+  EXPECT_EQ(static_cast<int64_t>(BinaryProtocol::ntoh64(msg.best_ask)),
+            1503000);
   EXPECT_EQ(BinaryProtocol::ntoh32(msg.bid_size), 100);
   EXPECT_EQ(BinaryProtocol::ntoh32(msg.ask_size), 150);
 }
@@ -166,3 +200,110 @@ TEST_F(ProtocolTest, ZeroCopyBufferHandling) {
     std::cout << "Received: " << received_str << std::endl;
   }
 }
+
+// Pipelined frames come out in order, in place, and a partial frame waits
+// for the rest of its bytes
+TEST_F(ProtocolTest, FrameDecoderSplitsPipelinedFrames) {
+  std::vector<uint8_t> stream;
+  for (uint64_t order_id = 1; order_id <= 40; ++order_id) {
+    auto order = BinaryProtocol::serializeNewOrder(order_id, true, 100, 1,
+                                                   "STOCK", "default");
+    stream.insert(stream.end(), order.begin(), order.end());
+  }
+
+  StreamBuffer input(1024);
+  FrameDecoder frames(input);
+  size_t split = stream.size() - sizeof(NewOrderMessage) / 2;
+  input.append(stream.data(), split);
+  const uint8_t *storage = input.data();
+
+  uint64_t expected = 1;
+  while (auto frame = frames.next()) {
+    EXPECT_EQ(frame->header.type, MessageType::NEW_ORDER);
+    ASSERT_EQ(frame->bytes.size(), sizeof(NewOrderMessage));
+    EXPECT_GE(frame->bytes.data(), storage); // a view, not a copy
+    const auto *order =
+        reinterpret_cast<const NewOrderMessage *>(frame->bytes.data());
+    EXPECT_EQ(BinaryProtocol::ntoh64(order->order_id), expected++);
+  }
+  EXPECT_EQ(expected, 40u);
+  EXPECT_EQ(input.size(),
+            sizeof(NewOrderMessage) - sizeof(NewOrderMessage) / 2);
+
+  input.append(stream.data() + split, stream.size() - split);
+  auto last = frames.next();
+  ASSERT_TRUE(last.has_value());
+  const auto *order =
+      reinterpret_cast<const NewOrderMessage *>(last->bytes.data());
+  EXPECT_EQ(BinaryProtocol::ntoh64(order->order_id), 40u);
+  EXPECT_FALSE(frames.next().has_value());
+  EXPECT_TRUE(input.empty());
+}
+
+// Reads reuse the same storage once consumed bytes are out of the way
+TEST_F(ProtocolTest, StreamBufferCompactsInsteadOfGrowing) {
+  StreamBuffer input(64);
+  for (int round = 0; round < 100; ++round) {
+    auto space = input.prepare(16);
+    ASSERT_GE(space.size(), 16u);
+    std::memset(space.data(), round, 16);
+    input.commit(16);
+    input.consume(input.size() - 6); // a partial message carries over
+  }
+  EXPECT_EQ(input.getCapacity(), 64u);
+  EXPECT_EQ(input.size(), 6u);
+  EXPECT_EQ(input.data()[0], 99);
+
+  // A frame larger than the buffer still fits once it grows
+  auto space = input.prepare(200);
+  EXPECT_GE(space.size(), 200u);
+  EXPECT_EQ(input.size(), 6u);
+  EXPECT_EQ(input.data()[5], 99);
+}
+
+TEST_F(ProtocolTest, JsonRequestParsesFieldsInPlace) {
+  JsonRequest request;
+  JsonProtocol::parseRequest(
+      R"({"type":"new_order","side":"sell","price":101,"quantity":5,)"
+      R"("order_id":7,"meta":{"price":"ignored","tags":[1,2]}})",
+      request);
+  EXPECT_EQ(request.type, "new_order");
+  EXPECT_EQ(request.side, "sell");
+  EXPECT_EQ(request.session_id, "default");
+  EXPECT_EQ(request.symbol, "STOCK");
+  EXPECT_DOUBLE_EQ(request.price.value(), 101.0);
+  EXPECT_EQ(request.quantity.value(), 5u);
+  EXPECT_EQ(request.order_id.value(), 7u);
+
+  // Reusing the request clears what the last one set
+  JsonProtocol::parseRequest(R"({"type":"join","username":"trader1"})",
+                             request);
+  EXPECT_EQ(request.username, "trader1");
+  EXPECT_FALSE(request.price.has_value());
+  EXPECT_TRUE(request.side.empty());
+
+  EXPECT_THROW(JsonProtocol::parseRequest(R"({"type":"join")", request),
+               std::runtime_error);
+  EXPECT_THROW(JsonProtocol::parseRequest(R"({"quantity":-1})", request),
+               std::runtime_error);
+  EXPECT_THROW(JsonProtocol::parseRequest(R"({"price":"100"})", request),
+               std::runtime_error);
+  EXPECT_THROW(JsonProtocol::parseRequest(R"([1,2])", request),
+               std::runtime_error);
+}
+
+TEST_F(ProtocolTest, LineDecoderKeepsPartialLines) {
+  StreamBuffer input;
+  LineDecoder lines(input);
+  std::string_view text = "first\r\nsecond\nthi";
+  input.append(text.data(), text.size());
+
+  EXPECT_EQ(lines.next().value(), "first");
+  EXPECT_EQ(lines.next().value(), "second");
+  EXPECT_FALSE(lines.next().has_value());
+  EXPECT_EQ(lines.getPending(), 3u);
+
+  input.append("rd\n", 3);
+  EXPECT_EQ(lines.next().value(), "third");
+  EXPECT_TRUE(input.empty());
+}
@@ -0,0 +1,28 @@
+#include "allocation_counter.hpp"
+#include <cstdlib>
+#include <new>
+
+namespace allocations {
+
+std::atomic<bool> counting_global{false};
+std::atomic<uint64_t> global_count{0};
+thread_local bool counting_thread = false;
+thread_local uint64_t thread_count = 0;
+
+} // namespace allocations
+
+void *operator new(size_t size) {
+  if (allocations::counting_thread) {
+    allocations::thread_count++;
+  }
+  if (allocations::counting_global.load(std::memory_order_relaxed)) {
+    allocations::global_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Counts calls to the global operator new, which allocation_counter.cpp
+// replaces. Linked into the test and benchmark targets so both count the
+// same way.
+namespace allocations {
+
+// Every thread's allocations while switched on
+extern std::atomic<bool> counting_global;
+extern std::atomic<uint64_t> global_count;
+
+// The calling thread's own allocations while switched on
+extern thread_local bool counting_thread;
+extern thread_local uint64_t thread_count;
+
+} // namespace allocations